@@ -1,50 +1,142 @@
 #include "Cache.h"
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// Non-empty components of path
+	std::vector<boost::string_ref> splitPath(boost::string_ref path)
+	{
+		std::vector<boost::string_ref> ret;
+		while(!path.empty())
+		{
+			size_t end=std::find(path.begin(),path.end(),'/')-path.begin();
+			if(end)
+				ret.push_back(path.substr(0,end));
+			path.remove_prefix(std::min(end+1,path.size()));
+		}
+		return ret;
+	}
+}
 
 Cache::Cache()
 {}
 
-INode *Cache::findByPath(const fs::path &path)
+void *Cache::operator new(size_t size)
 {
-	boost::shared_lock<boost::shared_mutex> lock{_m};
-	PathNodes::iterator it=_pathNodes.find(path);
-	if(it!=_pathNodes.end())
+	void *ret=nullptr;
+	if(posix_memalign(&ret,alignof(Cache),size)!=0)
+		throw std::bad_alloc();
+	return ret;
+}
+
+void Cache::operator delete(void *p)
+{
+	free(p);
+}
+
+INode *Cache::findByPath(boost::string_ref path)
+{
+	size_t hash=PathHash()(path);
+	Shard &s=_shard(hash);
+	boost::shared_lock<boost::shared_mutex> lock{s.m};
+	PathNodes::iterator it=s.pathNodes.find(path,[hash](boost::string_ref){ return hash; },PathEqual());
+	if(it!=s.pathNodes.end())
 		return it->second;
 	return nullptr;
 }
 
 INode *Cache::findById(const std::string &id)
 {
-	boost::shared_lock<boost::shared_mutex> lock{_m};
-	IdNodes::iterator it=_idNodes.find(id);
-	if(it!=_idNodes.end())
+	Shard &s=_shard(boost::hash<std::string>()(id));
+	boost::shared_lock<boost::shared_mutex> lock{s.m};
+	IdNodes::iterator it=s.idNodes.find(id);
+	if(it!=s.idNodes.end())
 		return it->second;
 	return nullptr;
 }
 
-Cache &Cache::insert(const fs::path &path, const std::string &id, INode *node)
+bool Cache::remove(const INode *node)
 {
-	boost::lock_guard<boost::shared_mutex> lock{_m};
-	_pathNodes[path]=node;
-	_idNodes[id]=node;
-	_nodes[node]=path;
-	return *this;
+	return _removeKeys(node,true);
 }
 
-void Cache::slotNodeRemoved(INode &node)
+Cache &Cache::insert(boost::string_ref path, const std::string &id, INode *node)
 {
-	// clear the cache
-	auto itNode=_nodes.find(&node);
-	if(itNode!=_nodes.end())
+	// node could be cached by previous path
+	remove(node);
+
+	// Shards are locked one by one, so there is no lock ordering issues
+	const std::string &key=path.to_string();
+	{
+		Shard &s=_shard(PathHash()(path));
+		boost::lock_guard<boost::shared_mutex> lock{s.m};
+		s.pathNodes[key]=node;
+	}
 	{
-		auto pathIt=_pathNodes.find(itNode->second);
-		if(pathIt!=_pathNodes.end())
-			_pathNodes.erase(pathIt);
+		Shard &s=_shard(boost::hash<std::string>()(id));
+		boost::lock_guard<boost::shared_mutex> lock{s.m};
+		s.idNodes[id]=node;
+	}
+	{
+		Shard &s=_shard(node);
+		boost::lock_guard<boost::shared_mutex> lock{s.m};
+		s.nodes[node]=Keys{key,id};
+	}
+	{
+		std::lock_guard<std::mutex> lock(_trieM);
+		Trie *t=&_trie;
+		for(const boost::string_ref &name : splitPath(path))
+		{
+			uptr<Trie> &next=t->next[name.to_string()];
+			if(!next)
+				next.reset(new Trie);
+			t=next.get();
+		}
+		t->entry=node;
+	}
+	return *this;
+}
 
-		auto idIt=_idNodes.find(node.getId());
-		if(idIt!=_idNodes.end())
-			_idNodes.erase(idIt);
-		_nodes.erase(itNode);
+void Cache::invalidate(boost::string_ref path)
+{
+	uptr<Trie> sub;
+	{
+		std::lock_guard<std::mutex> lock(_trieM);
+		const std::vector<boost::string_ref> &names=splitPath(path);
+		if(names.empty())
+		{
+			sub.reset(new Trie(std::move(_trie)));
+			_trie=Trie();
+		}
+		else
+		{
+			Trie *t=&_trie;
+			for(size_t i=0;t && i+1<names.size();++i)
+			{
+				auto it=t->next.find(names[i].to_string());
+				t=it!=t->next.end() ? it->second.get() : nullptr;
+			}
+			if(!t)
+				return;
+			auto it=t->next.find(names.back().to_string());
+			if(it==t->next.end())
+				return;
+			sub=std::move(it->second);
+			t->next.erase(it);
+		}
 	}
+
+	std::vector<const INode*> entries;
+	_collect(*sub,entries);
+	for(const INode *n : entries)
+		_removeKeys(n,false);
+}
+
+void Cache::slotNodeRemoved(INode &node)
+{
+	// clear the cache
+	remove(&node);
 }
 
 void Cache::slotNodeChanged(INode &node, int)
@@ -52,3 +144,75 @@ void Cache::slotNodeChanged(INode &node, int)
 	// I don't know enum Node::Fields here...
 	slotNodeRemoved(node);
 }
+
+bool Cache::_removeKeys(const INode *node,bool fromTrie)
+{
+	Keys keys;
+	{
+		Shard &s=_shard(node);
+		boost::lock_guard<boost::shared_mutex> lock{s.m};
+		auto itNode=s.nodes.find(node);
+		if(itNode==s.nodes.end())
+			return false;
+		keys=std::move(itNode->second);
+		s.nodes.erase(itNode);
+	}
+	// keys could be taken by other node already
+	{
+		Shard &s=_shard(PathHash()(keys.path));
+		boost::lock_guard<boost::shared_mutex> lock{s.m};
+		auto pathIt=s.pathNodes.find(keys.path);
+		if(pathIt!=s.pathNodes.end() && pathIt->second==node)
+			s.pathNodes.erase(pathIt);
+	}
+	{
+		Shard &s=_shard(boost::hash<std::string>()(keys.id));
+		boost::lock_guard<boost::shared_mutex> lock{s.m};
+		auto idIt=s.idNodes.find(keys.id);
+		if(idIt!=s.idNodes.end() && idIt->second==node)
+			s.idNodes.erase(idIt);
+	}
+	if(fromTrie)
+	{
+		std::lock_guard<std::mutex> lock(_trieM);
+		// way from root to remove branches left empty
+		std::vector<std::pair<Trie*,std::string>> way;
+		Trie *t=&_trie;
+		for(const boost::string_ref &name : splitPath(keys.path))
+		{
+			auto it=t->next.find(name.to_string());
+			if(it==t->next.end())
+				return true;
+			way.emplace_back(t,it->first);
+			t=it->second.get();
+		}
+		if(t->entry==node)
+			t->entry=nullptr;
+		while(!way.empty() && !t->entry && t->next.empty())
+		{
+			t=way.back().first;
+			t->next.erase(way.back().second);
+			way.pop_back();
+		}
+	}
+	return true;
+}
+
+void Cache::_collect(const Trie &t,std::vector<const INode*> &entries)
+{
+	if(t.entry)
+		entries.push_back(t.entry);
+	for(const auto &n : t.next)
+		_collect(*n.second,entries);
+}
+
+Cache::Shard &Cache::_shard(size_t hash)
+{
+	// the high bits are mixed better by boost::hash_range
+	return _shards[(hash ^ (hash>>(sizeof(size_t)*4))) % SHARDS];
+}
+
+Cache::Shard &Cache::_shard(const INode *node)
+{
+	return _shard(boost::hash<const INode*>()(node));
+}
@@ -1,31 +1,93 @@
 #pragma once
 
 #include "utils/decls.h"
+#include <array>
+#include <mutex>
 #include <boost/unordered_map.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/utility/string_ref.hpp>
 #include "fs/INode.h"
 
 // TODO Implement LRU cache
+/**
+ * @brief Lookup cache of nodes by path and by id
+ *
+ * Maps are split into shards by hash of key, every shard has own lock,
+ * so concurrent lookups and inserts of different paths don't contend.
+ * Cached paths are indexed by trie of path components as well, so entries
+ * of whole subtree are invalidated in O(descendants) on directory rename.
+ *
+ *********************************************************************/
 class Cache
 {
 public:
 	Cache();
-	INode *findByPath(const fs::path &path);
+	// C++14 operator new ignores extended alignment of shards, so it's requested explicitly
+	static void *operator new(size_t size);
+	static void operator delete(void *p);
+
+	INode *findByPath(boost::string_ref path);
 	INode *findById(const std::string &id);
 
 	bool remove(const INode *node);
-	Cache &insert(const fs::path& path, const std::string &id, INode *node);
+	Cache &insert(boost::string_ref path, const std::string &id, INode *node);
+	// Removes entry of path and entries of all paths under it
+	void invalidate(boost::string_ref path);
 
 	void slotNodeRemoved(INode &node);
 	void slotNodeChanged(INode &node, int);
 
 private:
-	boost::shared_mutex _m;
-	typedef boost::unordered_map<fs::path,INode*> PathNodes;
+	// Paths are hashed as plain strings, so lookup by string_ref doesn't allocate key
+	struct PathHash
+	{
+		size_t operator()(boost::string_ref path) const
+		{
+			return boost::hash_range(path.begin(),path.end());
+		}
+	};
+	struct PathEqual
+	{
+		bool operator()(boost::string_ref left,boost::string_ref right) const
+		{
+			return left==right;
+		}
+	};
+
+	typedef boost::unordered_map<std::string,INode*,PathHash,PathEqual> PathNodes;
 	typedef boost::unordered_map<std::string,INode*> IdNodes;
-	typedef boost::unordered_map<INode*,fs::path> Nodes;
-	PathNodes _pathNodes;
-	IdNodes _idNodes;
-	Nodes _nodes;
-};
+	// keys of node, they are removed together
+	struct Keys
+	{
+		std::string path;
+		std::string id;
+	};
+	typedef boost::unordered_map<const INode*,Keys> Nodes;
+
+	// Aligned to cache line to avoid false sharing between locks of neighbour shards
+	struct alignas(64) Shard
+	{
+		boost::shared_mutex m;
+		PathNodes pathNodes;
+		IdNodes idNodes;
+		Nodes nodes;
+	};
+	static const size_t SHARDS=64;
 
+	// Node of paths trie (entry is null for not cached directory on way to cached path)
+	struct Trie
+	{
+		const INode *entry=nullptr;
+		boost::unordered_map<std::string,uptr<Trie>> next;
+	};
+
+	Shard &_shard(size_t hash);
+	Shard &_shard(const INode *node);
+	bool _removeKeys(const INode *node,bool fromTrie);
+	void _collect(const Trie &t,std::vector<const INode*> &entries);
+
+	std::array<Shard,SHARDS> _shards;
+	// Trie is changed by inserts and removes only, lookups don't touch it
+	std::mutex _trieM;
+	Trie _trie;
+};
@@ -1,22 +1,28 @@
 #include "Application.h"
-#include "presentation/FuseGate.h"
 #include <unistd.h>
 #include <time.h>
 #include <sys/types.h>
 #include "Configuration.h"
 
-Application::Application(const std::string &email, int argc, char *argv[], const fs::path &manualConf)
+Application::Application(const Accounts &emails, int argc, char *argv[], const fs::path &manualConf)
 	: _argc(argc),
-	  _argv(argv),
-	  _email(email)
+	  _argv(argv)
 {
 	_conf=createGlobalConfiguration(manualConf);
-	if(_email.empty())
+	if(emails.empty())
 		G2F_EXCEPTION("e-mail id hasn't set").throwIt(G2FErrorCodes::WrongAppArguments);
-	const auto& factory=ProvidersRegistry::getInstance().detectByAccountName(_email);
-	_provider=factory->create(_conf);
-	if(!_provider)
-		G2F_EXCEPTION(_email).throwIt(G2FErrorCodes::CouldntDetermineProvider);
+	for(const std::string &email : emails)
+	{
+		if(email.empty())
+			G2F_EXCEPTION("e-mail id hasn't set").throwIt(G2FErrorCodes::WrongAppArguments);
+		const auto& factory=ProvidersRegistry::getInstance().detectByAccountName(email);
+		IProviderPtr &provider=_providers[factory->getName()];
+		if(!provider)
+			provider=factory->create(_conf);
+		if(!provider)
+			G2F_EXCEPTION(email).throwIt(G2FErrorCodes::CouldntDetermineProvider);
+		_accounts[email]=provider;
+	}
 	clock_gettime(CLOCK_REALTIME,&_startTime);
 }
 
@@ -43,28 +49,20 @@ const IConfigurationPtr &Application::getConfiguration()
 	return _conf;
 }
 
-int Application::fuseStart(const FUSEOpts &opts)
-{
-	const IProviderSessionPtr &sess=_provider->createSession(_email,_prArgs);
-	FuseGate drive(*sess);
-	return drive.run(opts);
-}
-
-int Application::fuseHelp()
-{
-	FuseGate::fuseHelp();
-	return 0;
-}
-
 int Application::createAuthFile(const std::string& authCode)
 {
 	int ret=0;
-	const IProviderSessionPtr &sess=_provider->createSession(_email,_prArgs);
-	const IOAuth2ProcessPtr &o2p=sess->createOAuth2Process();
-	if(authCode.empty())
-		o2p->startNativeApp();
-	else
-		ret=o2p->finishNativeApp(authCode);
+	if(!authCode.empty() && _accounts.size()>1)
+		G2F_EXCEPTION("authorization code is accepted for single account only").throwIt(G2FErrorCodes::WrongAppArguments);
+	for(const auto &acc : _accounts)
+	{
+		const IProviderSessionPtr &sess=acc.second->createSession(acc.first,_prArgs);
+		const IOAuth2ProcessPtr &o2p=sess->createOAuth2Process();
+		if(authCode.empty())
+			o2p->startNativeApp();
+		else
+			ret=o2p->finishNativeApp(authCode);
+	}
 	return ret;
 }
 
@@ -93,9 +91,9 @@ namespace
 	uptr<Application> theApp;
 }
 
-Application *Application::create(const std::string &email, int argc, char *argv[], const fs::path &manualConf)
+Application *Application::create(const Accounts &emails, int argc, char *argv[], const fs::path &manualConf)
 {
-	theApp.reset(new Application(email,argc,argv,manualConf));
+	theApp.reset(new Application(emails,argc,argv,manualConf));
 	return theApp.get();
 }
 
@@ -5,12 +5,14 @@
 #include "IConfiguration.h"
 #include "FuseOpts.h"
 #include "providers/ProvidersRegistry.h"
+#include <map>
 
 class Application
 {
 public:
 
 	typedef std::vector<std::string> ProviderArgs;
+	typedef std::vector<std::string> Accounts;
 
 	Application& setDebug(bool value=true);
 	Application& setReadOnly(bool value=true);
@@ -24,7 +26,7 @@ public:
 	// Print out fuse help
 	static int fuseHelp();
 
-	// Authenticate in Google, create file
+	// Authenticate in Google, create file (code is accepted for single account only)
 	int createAuthFile(const std::string &authCode);
 
 	static uid_t getUID();
@@ -32,11 +34,11 @@ public:
 	static std::string applicationName();
 	timespec startTime();
 
-	static Application *create(const std::string &email,int argc, char *argv[], const fs::path &manualConf);
+	static Application *create(const Accounts &emails,int argc, char *argv[], const fs::path &manualConf);
 	static Application *instance();
 
 private:
-	Application(const std::string &email, int argc, char *argv[], const boost::filesystem::path &manualConf);
+	Application(const Accounts &emails, int argc, char *argv[], const boost::filesystem::path &manualConf);
 
 	int _argc;
 	char **_argv;
@@ -45,9 +47,10 @@ private:
 	bool _readOnly=false;
 
 	IConfigurationPtr _conf;
-	IProviderPtr _provider;
+	// Accounts of the same provider share it (and resources of their sessions)
+	std::map<std::string,IProviderPtr> _providers;
+	std::map<std::string,IProviderPtr> _accounts;
 
-	std::string _email;
 	ProviderArgs _prArgs;
 	timespec _startTime;
 };
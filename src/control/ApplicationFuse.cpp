@@ -0,0 +1,18 @@
+// Parts of Application depending on libfuse (the rest is linked to tests without it)
+#include "Application.h"
+#include "presentation/FuseGate.h"
+
+int Application::fuseStart(const FUSEOpts &opts)
+{
+	FuseGate::Sessions sessions;
+	for(const auto &acc : _accounts)
+		sessions[acc.first]=acc.second->createSession(acc.first,_prArgs);
+	FuseGate drive(sessions);
+	return drive.run(opts);
+}
+
+int Application::fuseHelp()
+{
+	FuseGate::fuseHelp();
+	return 0;
+}
@@ -16,24 +16,22 @@ public:
 public:
 	virtual bool hasNext() override
 	{
-		bool ret=(*_it)->hasNext();
-		if(ret)
-			return ret;
-
-		// Is something more?
-		if(_it==&_upstream)
-			return _current->hasNext();
-		return ret;
+		_skipExhausted();
+		return (*_it)->hasNext();
 	}
 	virtual IPropertyDefinitionPtr next() override
 	{
-		const auto &ret=(*_it)->next();
-		if(!(*_it)->hasNext() && _it==&_upstream)
-			_it=&_current;
-		return ret;
+		_skipExhausted();
+		return (*_it)->next();
 	}
 
 private:
+	void _skipExhausted()
+	{
+		if(_it==&_upstream && !_upstream->hasNext())
+			_it=&_current;
+	}
+
 	IPropertyIteratorPtr _upstream;
 	IPropertyIteratorPtr _current;
 	IPropertyIteratorPtr *_it=nullptr;
@@ -113,5 +111,10 @@ G2FError ChainedConfiguration::setProperty(const std::string &name, const std::s
 
 IPropertiesListPtr ChainedConfiguration::getProperiesList()
 {
-	return std::make_shared<ChainedPropertiesList>(_upstream->getProperiesList(),_current->getProperiesList());
+	return createChainedPropertiesList(_upstream->getProperiesList(),_current->getProperiesList());
+}
+
+IPropertiesListPtr createChainedPropertiesList(const IPropertiesListPtr &upstream, const IPropertiesListPtr &current)
+{
+	return std::make_shared<ChainedPropertiesList>(upstream,current);
 }
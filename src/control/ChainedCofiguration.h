@@ -19,3 +19,6 @@ private:
 	IConfigurationPtr _upstream;
 	IConfigurationPtr _current;
 };
+
+// Properties of 'current' list hide same-named properties of 'upstream'
+IPropertiesListPtr createChainedPropertiesList(const IPropertiesListPtr &upstream,const IPropertiesListPtr &current);
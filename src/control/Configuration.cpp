@@ -13,8 +13,20 @@ const AbstractStaticInitPropertiesList::PropDefi propsDefi[]=
 //	name							type					enum		def					change	descr
 	"change_collision_strategy",	IPropertyType::ENUM,	"coll",		"prefer_remote",	true,	"Strategy of resolving collision of changed files.",
 	"cache_max_size",				IPropertyType::UINT,	0,			"100",				true,	"Max size of file cache (Megabytes).",
+	"cache_max_files",				IPropertyType::UINT,	0,			"0",				true,	"Max number of files in file cache (0 - unlimited).",
+	"cache_eviction_policy",		IPropertyType::ENUM,	"cevp",		"lru",				true,	"Policy of removing files from full file cache.",
+	"cache_direct_io",				IPropertyType::BOOL,	0,			"false",			false,	"Write downloaded content into cache bypassing page cache (O_DIRECT).",
+	"cache_preallocate",			IPropertyType::BOOL,	0,			"true",				false,	"Reserve disk space of cached file before download.",
 	"read_only",					IPropertyType::BOOL,	0,			"false",			true,	"Read-only mode.",
 	"cache_prefetch_strategy",		IPropertyType::ENUM,	"cpst",		"lazy",				true,	"Strategy of anticipatory caching.",
+	"prefetch_depth",				IPropertyType::UINT,	0,			"2",				false,	"Depth of subdirectories listed ahead on directory listing (for eager prefetch strategy).",
+	"prefetch_breadth",				IPropertyType::UINT,	0,			"32",				false,	"Max number of subdirectories of directory listed ahead (0 - unlimited).",
+	"prefetch_threads",				IPropertyType::UINT,	0,			"4",				false,	"Number of simultaneous requests of directories prefetch.",
+	"warm_up_paths",				IPropertyType::STRING,	0,			"",					true,	"Globs of paths (separated by ';') to prefetch into cache.",
+	"warm_up_interval",				IPropertyType::UINT,	0,			"0",				false,	"Interval of cache warming (minutes, 0 - only by request).",
+	"warm_up_threads",				IPropertyType::UINT,	0,			"2",				false,	"Number of simultaneous requests of cache warming.",
+	"copy_threads",					IPropertyType::UINT,	0,			"8",				false,	"Number of simultaneous server side copies of files on folder copy.",
+	"download_threads",				IPropertyType::UINT,	0,			"4",				false,	"Number of files downloaded in background while they are read (0 - open waits for whole file).",
 	"permission_new_file",			IPropertyType::OINT,	0,			"644",				true,	"New files permissions.",
 	"permission_new_folder",		IPropertyType::OINT,	0,			"755",				true,	"New directory permissions.",
 	"permission_new_spec",			IPropertyType::OINT,	0,			"444",				true,	"Permissions to new special files (non editable).",
@@ -23,7 +35,10 @@ const AbstractStaticInitPropertiesList::PropDefi propsDefi[]=
 	"limit_upload_max",				IPropertyType::UINT,	0,			"0",				true,	"Max upload speed (kilobits/sec).",
 	"limit_download_max",			IPropertyType::UINT,	0,			"0",				true,	"Max download speed (kilobits/sec).",
 	"limit_upload_min",				IPropertyType::UINT,	0,			"0",				true,	"Min upload speed limit after that sync will be disabled (kilobits/sec).",
-	"control_dir",					IPropertyType::PATH,	0,			"/.control",		false,	"Control directory's mountpoint."
+	"control_dir",					IPropertyType::PATH,	0,			"/.control",		false,	"Control directory's mountpoint.",
+	"op_deadline",					IPropertyType::UINT,	0,			"60",				false,	"Time budget of file operation for retrying failed cloud requests (seconds, 0 - unlimited).",
+	"io_policy",					IPropertyType::STRING,	0,			"size>=256M:direct_io",	false,	"Rules (separated by ';') of kernel caching of opened files, e.g. 'size>=256M:direct_io; path=/etc/*:keep_cache'.",
+	"fuse_read_ahead",				IPropertyType::UINT,	0,			"0",				false,	"Max kernel read-ahead of files (Kilobytes, 0 - kernel default)."
 	// TODO Add property describes temporary files to exclude from exchange process
 };
 
@@ -38,6 +53,10 @@ const AbstractStaticInitPropertiesList::EnumDefi enumDefi[]=
 		{ "eager", "Aggresive anticipatory caching." },
 		{ "lazy",  "Balanced and soft :)" }	// TODO Rewrite
 	},
+	"cevp", {
+		{ "lru", "Least recently used files are removed first." },
+		{ "lfu", "Least frequently used files are removed first." }
+	},
 	"erpo", {
 		{ "forever", "Final deletion." },
 		{ "trash",	 "Delete to trash." }
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <boost/optional.hpp>
+#include <boost/lexical_cast.hpp>
 #include "utils/decls.h"
 #include "error/G2FException.h"
 #include "props/IPropertiesList.h"
@@ -21,3 +22,29 @@ public:
 };
 
 G2F_DECLARE_PTR(IConfiguration);
+
+
+// Returns typed value of property or 'def' if property is absent or malformed
+template<typename T>
+T getPropertyAs(IConfiguration &conf,const std::string &name,const T &def)
+{
+	const boost::optional<std::string> &v=conf.getProperty(name);
+	if(!v)
+		return def;
+	try
+	{
+		return boost::lexical_cast<T>(*v);
+	}
+	catch(const boost::bad_lexical_cast&)
+	{}
+	return def;
+}
+
+template<>
+inline bool getPropertyAs<bool>(IConfiguration &conf,const std::string &name,const bool &def)
+{
+	const boost::optional<std::string> &v=conf.getProperty(name);
+	if(!v)
+		return def;
+	return *v=="true" || *v=="1";
+}
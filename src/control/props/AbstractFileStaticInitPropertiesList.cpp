@@ -7,12 +7,13 @@
 //#include <boost/utility/string_ref.hpp>
 #include <regex>
 
-const char *rePattern=R"--(^\s*(\w+)\s*=\s*(\w+))--";
+// value is the rest of line (URLs and rules have punctuation and spaces)
+const char *rePattern=R"--(^\s*(\w+)\s*=\s*(.*\S)\s*$)--";
 bool updateConf(std::fstream &f,const std::string &name,const std::string &val)
 {
 	std::regex re(rePattern);
 
-	char line[128];
+	char line[1024];
 	std::fstream::pos_type offset=-1;
 
 	// Will read file line by line while we do not detect given property.
@@ -54,7 +55,7 @@ bool readConf(std::fstream &f,const std::string &name,std::string &val)
 {
 	std::regex re(rePattern);
 
-	char line[128];
+	char line[1024];
 	while(!f.eof())
 	{
 		f.getline(line,sizeof(line));
@@ -33,7 +33,8 @@ public:
 	virtual G2FError setValue(const std::string &val) override
 	{
 		std::string lv(val);
-		AbstractStaticInitPropertiesList::normalizeValue(lv);
+		IPropertyType::Type type=_upstream->getType()->getType();
+		AbstractStaticInitPropertiesList::normalizeValue(lv,type==IPropertyType::PATH || type==IPropertyType::STRING);
 		if(!_upstream->getType()->checkValidity(lv))
 			return G2FError(EINVAL,err::system_category());
 
@@ -202,9 +202,10 @@ IPropertyIteratorPtr AbstractStaticInitPropertiesList::getProperties()
 	return _impl->getIterator();
 }
 
-std::string &AbstractStaticInitPropertiesList::normalizeValue(std::string &value)
+std::string &AbstractStaticInitPropertiesList::normalizeValue(std::string &value,bool caseSensitive)
 {
-	boost::to_lower(value);
+	if(!caseSensitive)
+		boost::to_lower(value);
 	std::string syms(" \n\t");
 	boost::trim_if(value,[&](const auto &c){ return syms.find(c)!=std::string::npos;});
 	return value;
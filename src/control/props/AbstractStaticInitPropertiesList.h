@@ -41,7 +41,8 @@ public:
 	virtual size_t getPropertiesSize() override;
 	virtual IPropertyIteratorPtr getProperties() override;
 
-	static std::string& normalizeValue(std::string& value);
+	// Values of case sensitive types (paths, strings) are only trimmed
+	static std::string& normalizeValue(std::string& value,bool caseSensitive=false);
 
 protected:
 	virtual std::pair<const PropDefi*,size_t> getPropertiesDefinition() =0;
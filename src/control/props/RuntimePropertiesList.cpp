@@ -0,0 +1,164 @@
+#include "RuntimePropertiesList.h"
+#include "control/Application.h"
+#include "control/types/PropertyTypesRegistry.h"
+#include <boost/algorithm/string.hpp>
+
+
+//
+//			Property
+//
+////////////////////////////////////
+class RuntimeProperty : public IPropertyDefinition
+{
+public:
+	RuntimeProperty(const std::string &name,const IPropertyTypePtr &type,const std::string &description,
+					const RuntimePropertiesList::Getter &getter,const RuntimePropertiesList::Setter &setter)
+		: _name(name),
+		  _type(type),
+		  _description(description),
+		  _getter(getter),
+		  _setter(setter)
+	{
+		CLEAR_TIMESPEC(_lastChange);
+	}
+
+	// IPropertyDefinition interface
+public:
+	virtual std::string getName() override
+	{
+		return _name;
+	}
+
+	virtual std::string getValue() override
+	{
+		return _getter();
+	}
+
+	virtual G2FError setValue(const std::string &val) override
+	{
+		if(!_setter)
+			return G2FError(G2FErrorCodes::NotSupported);
+
+		// Values can be case sensitive (paths, for example), so only trim them
+		const std::string &lv=boost::trim_copy(val);
+		if(!_type->checkValidity(lv))
+			return G2FError(EINVAL,err::system_category());
+		G2FError ret=_setter(lv);
+		if(!ret.isError())
+			clock_gettime(CLOCK_REALTIME,&_lastChange);
+		return ret;
+	}
+
+	virtual std::string getDescription() override
+	{
+		return _description;
+	}
+
+	virtual IPropertyTypePtr getType() override
+	{
+		return _type;
+	}
+
+	virtual bool isRuntimeChange() override
+	{
+		return !(!_setter);
+	}
+
+	virtual std::string getDefaultValue() override
+	{
+		return std::string();
+	}
+
+	virtual timespec getLastChangeTime() override
+	{
+		if(!ISSET_TIMESPEC(_lastChange))
+			return Application::instance()->startTime();
+		return _lastChange;
+	}
+
+	virtual bool resetToDefault() override
+	{
+		return false;
+	}
+
+private:
+	std::string _name;
+	IPropertyTypePtr _type;
+	std::string _description;
+	RuntimePropertiesList::Getter _getter;
+	RuntimePropertiesList::Setter _setter;
+	timespec _lastChange;
+};
+
+
+
+class RuntimePropertyIterator : public IPropertyIterator
+{
+public:
+	RuntimePropertyIterator(const std::map<std::string,IPropertyDefinitionPtr> &map)
+		: _it(map.begin()),
+		  _itEnd(map.end())
+	{}
+
+	// IPropertyIterator interface
+public:
+	virtual bool hasNext() override
+	{
+		return _it!=_itEnd;
+	}
+	virtual IPropertyDefinitionPtr next() override
+	{
+		return (_it++)->second;
+	}
+
+private:
+	std::map<std::string,IPropertyDefinitionPtr>::const_iterator _it,_itEnd;
+};
+
+
+
+
+//
+//	RuntimePropertiesList
+//
+///////////////////////////////////////////////
+RuntimePropertiesList::RuntimePropertiesList(const std::string &name)
+	: _name(name)
+{}
+
+RuntimePropertiesList &RuntimePropertiesList::add(const std::string &name, IPropertyType::Type type, const std::string &description,
+												  const Getter &getter, const Setter &setter)
+{
+	const IPropertyTypePtr &t=PropertyTypesRegistry::getInstance().getType(type);
+	assert(t);
+	_props[name]=std::make_shared<RuntimeProperty>(name,t,description,getter,setter);
+	return *this;
+}
+
+std::string RuntimePropertiesList::getName()
+{
+	return _name;
+}
+
+IPropertyDefinitionPtr RuntimePropertiesList::findProperty(const std::string &name)
+{
+	auto it=_props.find(name);
+	if(it!=_props.end())
+		return it->second;
+	return IPropertyDefinitionPtr();
+}
+
+bool RuntimePropertiesList::isEmpty()
+{
+	return _props.empty();
+}
+
+size_t RuntimePropertiesList::getPropertiesSize()
+{
+	return _props.size();
+}
+
+IPropertyIteratorPtr RuntimePropertiesList::getProperties()
+{
+	return std::make_shared<RuntimePropertyIterator>(_props);
+}
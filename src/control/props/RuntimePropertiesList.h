@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include "utils/decls.h"
+#include "IPropertiesList.h"
+
+/*
+ * Properties backed by functions. Exposes runtime state of components
+ * (and their runtime controls) in the control directory.
+ *
+ * ***********************************************************/
+class RuntimePropertiesList : public IPropertiesList
+{
+public:
+	typedef std::function<std::string()> Getter;
+	typedef std::function<G2FError(const std::string&)> Setter;
+
+	RuntimePropertiesList(const std::string &name);
+
+	// Property without setter is read-only
+	RuntimePropertiesList &add(const std::string &name,IPropertyType::Type type,const std::string &description,
+							   const Getter &getter,const Setter &setter=Setter());
+
+	// IPropertiesList interface
+public:
+	virtual std::string getName() override;
+	virtual IPropertyDefinitionPtr findProperty(const std::string &name) override;
+	virtual bool isEmpty() override;
+	virtual size_t getPropertiesSize() override;
+	virtual IPropertyIteratorPtr getProperties() override;
+
+private:
+	typedef std::map<std::string,IPropertyDefinitionPtr> PropsMap;
+
+	std::string _name;
+	PropsMap _props;
+};
+G2F_DECLARE_PTR(RuntimePropertiesList);
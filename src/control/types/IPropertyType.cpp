@@ -6,6 +6,7 @@ BEGIN_ENUM_MAP_C(IPropertyType,Type)
 	ENUM_MAP_ITEM_STR(IPropertyType::OINT,	"OINT")
 	ENUM_MAP_ITEM_STR(IPropertyType::BOOL,	"BOOL")
 	ENUM_MAP_ITEM_STR(IPropertyType::PATH,	"PATH")
+	ENUM_MAP_ITEM_STR(IPropertyType::STRING,	"STRING")
 END_ENUM_MAP_C
 
 
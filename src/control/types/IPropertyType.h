@@ -15,7 +15,8 @@ public:
 		UINT,
 		OINT,
 		BOOL,
-		PATH
+		PATH,
+		STRING
 	};
 
 	virtual Enum<Type> getType() =0;
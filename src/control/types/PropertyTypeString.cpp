@@ -0,0 +1,15 @@
+#include "PropertyTypeString.h"
+#include "PropertyTypesRegistry.h"
+
+
+Enum<IPropertyType::Type> PropertyTypeString::getType()
+{
+	return IPropertyType::STRING;
+}
+
+bool PropertyTypeString::checkValidity(const std::string &value)
+{
+	return true;
+}
+
+G2F_REGISTER_REGULAR_TYPE(PropertyTypeString);
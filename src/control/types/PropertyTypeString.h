@@ -0,0 +1,12 @@
+#pragma once
+
+#include "IPropertyType.h"
+
+class PropertyTypeString : public IPropertyType
+{
+
+	// IPropertyType interface
+public:
+	virtual Enum<Type> getType() override;
+	virtual bool checkValidity(const std::string &value) override;
+};
@@ -62,6 +62,8 @@ public:
 			return G2FMESSAGE("Authentication failed");
 		case MD5Error:
 			return G2FMESSAGE("MD5 error");
+		case HttpRateLimitError:
+			return G2FMESSAGE("HTTP requests rate limit exceeded");
 		}
 		return G2FMESSAGE("Unknown error");
 	}
@@ -101,6 +103,7 @@ public:
 			case HttpTransportError:
 			case HttpClientError:
 			case HttpServerError:
+			case HttpRateLimitError:
 				{
 					if(cond==err::errc::io_error)
 						return true;
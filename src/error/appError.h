@@ -25,7 +25,8 @@ enum G2FErrorCodes
 	UnknownEnvVariable,
 	PathError,
 	AuthenticationFailed,
-	MD5Error
+	MD5Error,
+	HttpRateLimitError
 };
 
 namespace boost
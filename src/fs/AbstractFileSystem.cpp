@@ -6,10 +6,41 @@
 #include "IContentHandle.h"
 #include <fcntl.h>
 #include "utils/assets.h"
+#include "utils/AlignedBuffer.h"
+#include <boost/pool/singleton_pool.hpp>
+#include <boost/bind/bind.hpp>
 
 namespace
 {
 	const fs::path ROOT_PATH("/");
+
+	void copyContent(INode &from,INode &to)
+	{
+		// TODO Change open flags on something independent from POSIX
+		size_t size=from.getSize();
+		if(size)
+		{
+			uptr<IContentHandle> hSource(from.openContent(O_RDONLY));
+			uptr<IContentHandle> hDest(to.openContent(O_CREAT));
+
+			AlignedBuffer buf;
+			off_t offset=0;
+			int readed=0;
+			while(size!=0 && (readed=hSource->read(buf.data(),buf.size(),offset))!=0)
+			{
+				if(readed==-1)
+					G2F_EXCEPTION("Can't read imported file '%1'").arg(from.getName()).throwItSystem(hSource->getError());
+				if(hDest->write(buf.data(),readed,offset)==-1)
+					G2F_EXCEPTION("Can't write imported file '%1'").arg(from.getName()).throwItSystem(hDest->getError());
+				offset+=readed;
+			}
+			hDest->close();
+			hSource->close();
+		}
+	}
+
+	struct NodePoolTag {};
+	typedef boost::singleton_pool<NodePoolTag,sizeof(AbstractFileSystem::Node)> NodePool;
 }
 
 
@@ -75,29 +106,36 @@ private:
  * @brief Directory's observer
  *
  **************************************/
+/**
+ * @brief Iterator over snapshot of children
+ *
+ * List of children is changed by change feed and refilling under tree
+ * mutex, so it's copied under the mutex instead of being iterated in place.
+ *****************************************/
 class DirIt : public IDirectoryIterator
 {
 public:
-	DirIt(const AbstractFileSystem::Node::iterator &begin,const AbstractFileSystem::Node::iterator &end)
-		: _it(begin),
-		  _itEnd(end)
-	{}
+	DirIt(AbstractFileSystem::Node &dir,std::recursive_mutex &treeM)
+	{
+		std::lock_guard<std::recursive_mutex> lock(treeM);
+		for(AbstractFileSystem::Node &n : dir)
+			_children.push_back(&n);
+	}
 
 	// IDirectoryIterator interface
 public:
 	virtual bool hasNext() override
 	{
-		return _it!=_itEnd;
+		return _pos<_children.size();
 	}
 	virtual INode *next() override
 	{
-		AbstractFileSystem::Node *ret=&*_it;
-		++_it;
-		return ret;
+		return _children[_pos++];
 	}
 
 private:
-	AbstractFileSystem::Node::iterator _it,_itEnd;
+	std::vector<AbstractFileSystem::Node*> _children;
+	size_t _pos=0;
 };
 
 
@@ -115,11 +153,15 @@ private:
 class AbstractFileSystem::Node::FileHandle : public IContentHandle
 {
 public:
-	FileHandle(AbstractFileSystem::Node *node,int64_t fd,bool changed)
+	FileHandle(AbstractFileSystem::Node *node,int64_t fd,bool changed,const ContentDownloadPtr &download=nullptr)
 		: _n(node),
 		  _fd(fd),
-		  _changed(changed)
-	{}
+		  _changed(changed),
+		  _download(download)
+	{
+		std::lock_guard<std::recursive_mutex> lock(_n->_tree->_treeM);
+		++_n->_handles;
+	}
 	~FileHandle()
 	{
 		try
@@ -129,6 +171,7 @@ public:
 		}
 		catch(...)
 		{}
+		_n->_tree->_releaseHandle(_n);
 	}
 
 	// IContentHandle interface
@@ -148,8 +191,20 @@ public:
 		return _error;
 	}
 
+	virtual bool useDirectIO() override
+	{
+		// reported size of exported file could be estimation, so reads mustn't be cut by it
+		return _n->getNodeType()==NodeType::Exported;
+	}
+
 	virtual int read(char *buf, size_t len, off_t offset) override
 	{
+		// content is still being downloaded
+		if(_download)
+		{
+			if(posix_error_code err=_download->waitFor(offset+len))
+				return -err;
+		}
 		return _n->_tree->_cm->readContent(_fd,buf,len,offset);
 	}
 
@@ -173,6 +228,7 @@ private:
 	int64_t _fd=-1;
 	posix_error_code _error=0;
 	bool _changed=false;
+	ContentDownloadPtr _download;
 
 	// IContentHandle interface
 public:
@@ -196,16 +252,62 @@ AbstractFileSystem::Node::Node(AbstractFileSystem *tree,Node *parent)
 	  _parent(parent)
 {}
 
+void *AbstractFileSystem::Node::operator new(size_t size)
+{
+	// chunks of pool fit exactly Node, descendants are allocated as usual
+	if(size!=sizeof(Node))
+		return ::operator new(size);
+	void *ret=NodePool::malloc();
+	if(!ret)
+		throw std::bad_alloc();
+	return ret;
+}
+
+void AbstractFileSystem::Node::operator delete(void *p,size_t size)
+{
+	if(!p)
+		return;
+	if(size!=sizeof(Node))
+		::operator delete(p);
+	else
+		NodePool::free(p);
+}
+
+uint64_t AbstractFileSystem::Node::_packTime(const timespec &ts)
+{
+	if(ts.tv_sec<0)
+		return 0;
+	return (static_cast<uint64_t>(ts.tv_sec)<<30) | static_cast<uint64_t>(ts.tv_nsec);
+}
+
+timespec AbstractFileSystem::Node::_unpackTime(uint64_t packed)
+{
+	timespec ret;
+	ret.tv_sec=static_cast<time_t>(packed>>30);
+	ret.tv_nsec=static_cast<long>(packed & ((1<<30)-1));
+	return ret;
+}
+
 // INode interface
 INode::NodeType AbstractFileSystem::Node::getNodeType()
 {
-	return _fileType;
+	return static_cast<NodeType>(_fileType);
 }
 
 void AbstractFileSystem::Node::fillAttr(struct stat &statbuf)
 {
 	memset(&statbuf,0,sizeof(struct stat));
-	statbuf.st_size=_size;
+	// Size of exported content is unknown until export. Size of previous export
+	// (kept in cache across restarts) or estimation is reported instead of exporting on stat
+	// Node isn't changed by stat, it's done without tree lock
+	uint64_t size=_size;
+	if(!size && getNodeType()==NodeType::Exported)
+	{
+		size=_tree->_cm->getCachedSize(getId());
+		statbuf.st_size=size ? size : _tree->_exportSizeEstimate;
+	}
+	else
+		statbuf.st_size=size;
 	//statbuf.st_mode=0;
 	if(!isFolder())
 		statbuf.st_mode|=S_IFREG;
@@ -223,14 +325,14 @@ void AbstractFileSystem::Node::fillAttr(struct stat &statbuf)
 	statbuf.st_uid=Application::getUID();
 	statbuf.st_gid=Application::getGID();
 	statbuf.st_ino=reinterpret_cast<ino_t>(this);
-	statbuf.st_atim=_lastAccess;
-	statbuf.st_mtim=_lastModification;
-	statbuf.st_ctim=_lastChange;
+	statbuf.st_atim=_unpackTime(_times[AccessTime]);
+	statbuf.st_mtim=_unpackTime(_times[ModificationTime]);
+	statbuf.st_ctim=_unpackTime(_times[ChangeTime]);
 }
 
 std::string AbstractFileSystem::Node::getId()
 {
-	return _id;
+	return _id.str();
 }
 
 void AbstractFileSystem::Node::setId(const std::string &id)
@@ -240,12 +342,12 @@ void AbstractFileSystem::Node::setId(const std::string &id)
 
 boost::filesystem::path AbstractFileSystem::Node::getName()
 {
-	return _name;
+	return _name.str();
 }
 
 void AbstractFileSystem::Node::setName(const fs::path &name)
 {
-	_name=name;
+	_name=name.string();
 }
 
 void AbstractFileSystem::Node::setSize(size_t size)
@@ -260,33 +362,12 @@ size_t AbstractFileSystem::Node::getSize()
 
 void AbstractFileSystem::Node::setTime(TimeAttrib what, timespec value)
 {
-	timespec *p=&_lastAccess;
-	switch(what)
-	{
-	case TimeAttrib::ModificationTime:
-		p=&_lastModification;
-		break;
-	case TimeAttrib::ChangeTime:
-		p=&_lastChange;
-		break;
-	default:
-		break;
-	}
-	*p=value;
+	_times[what]=_packTime(value);
 }
 
 timespec AbstractFileSystem::Node::getTime(TimeAttrib what)
 {
-	switch(what)
-	{
-	case TimeAttrib::ModificationTime:
-		return _lastModification;
-		break;
-	case TimeAttrib::ChangeTime:
-		return _lastChange;
-		break;
-	}
-	return _lastAccess;
+	return _unpackTime(_times[what]);
 }
 
 IDirectoryIteratorPtr AbstractFileSystem::Node::getDirectoryIterator()
@@ -295,8 +376,12 @@ IDirectoryIteratorPtr AbstractFileSystem::Node::getDirectoryIterator()
 	{
 		if(!_dirFilled)
 			_tree->fillDir(this);
-		IDirectoryIteratorPtr ret=std::make_shared<DirIt>(_next.begin(),_next.end());
-		clock_gettime(CLOCK_REALTIME,&_lastAccess);
+		if(_tree->_prefetchPool)
+			_tree->_prefetchChildren(getId(),_tree->_prefetchDepth);
+		IDirectoryIteratorPtr ret=std::make_shared<DirIt>(*this,_tree->_treeM);
+		timespec now;
+		clock_gettime(CLOCK_REALTIME,&now);
+		setTime(AccessTime,now);
 		return ret;
 	}
 	return IDirectoryIteratorPtr();
@@ -306,26 +391,32 @@ IContentHandle *AbstractFileSystem::Node::openContent(int flags)
 {
 	bool willBeCreated=false;
 	ContentManager &cm=*_tree->_cm;
-	bool exists=cm.is(_id);
+	// Handle for reading doesn't wait for the whole content
+	bool readOnly=(flags&O_ACCMODE)==O_RDONLY && !(flags&(O_CREAT|O_TRUNC));
+	ContentDownloadPtr download;
 	if(flags&O_CREAT)
 	{
-		if(!exists)
+		if(!_isContentCached())
 			willBeCreated=true;
 		else
 		if(flags&O_EXCL)
-			willBeCreated=cm.deleteFile(_id);
+			willBeCreated=cm.deleteFile(getId());
 	}
 
 	if(!willBeCreated)
 	{
-		if(!exists)
-			cm.createFile(_id,_tree->cloudReadMedia(*this).get());
+		if(readOnly && _tree->_downloadPool)
+			download=_tree->_startDownload(*this,true);
+		else
+			_fetchContent();
 	}
 
-	int64_t fd=cm.openFile(_id,flags);
-	clock_gettime(CLOCK_REALTIME,&_lastAccess);
+	int64_t fd=cm.openFile(getId(),flags);
+	timespec now;
+	clock_gettime(CLOCK_REALTIME,&now);
+	setTime(AccessTime,now);
 
-	return new FileHandle(this,fd,willBeCreated);
+	return new FileHandle(this,fd,willBeCreated,download);
 }
 
 posix_error_code AbstractFileSystem::Node::truncate(off_t newSize)
@@ -333,12 +424,39 @@ posix_error_code AbstractFileSystem::Node::truncate(off_t newSize)
 	if(this->isFolder())
 		return EISDIR;
 	ContentManager &cm=*_tree->_cm;
-	if(!cm.is(_id))
-		cm.createFile(_id,_tree->cloudReadMedia(*this).get());
-	cm.truncateFile(_id,_size,newSize);
+	_fetchContent();
+	cm.truncateFile(getId(),_size,newSize);
 	return 0;
 }
 
+bool AbstractFileSystem::Node::isFilled() const
+{
+	return _dirFilled;
+}
+
+void AbstractFileSystem::Node::_fetchContent()
+{
+	// concurrent fetches of the same content share one transfer
+	if(ContentDownloadPtr download=_tree->_startDownload(*this,false))
+	{
+		if(posix_error_code err=download->wait())
+			G2F_EXCEPTION("Download of content of '%1' failed").arg(getPath()).throwItSystem(err);
+	}
+}
+
+bool AbstractFileSystem::Node::_isContentCached()
+{
+	// partially downloaded content mustn't be changed or taken for stale
+	const ContentAccess &access=_tree->_accessContent(*this,false);
+	if(access.download)
+	{
+		if(posix_error_code err=access.download->wait())
+			G2F_EXCEPTION("Download of content of '%1' failed").arg(getPath()).throwItSystem(err);
+		return true;
+	}
+	return access.cached;
+}
+
 
 MD5Signature AbstractFileSystem::Node::getMD5()
 {
@@ -350,9 +468,40 @@ void AbstractFileSystem::Node::setMD5(const MD5Signature &md5)
 	_md5=md5;
 }
 
+std::string AbstractFileSystem::Node::getEtag() const
+{
+	return _etag.str();
+}
+
+boost::string_ref AbstractFileSystem::Node::getIdRef() const
+{
+	return _id.ref();
+}
+
+boost::string_ref AbstractFileSystem::Node::getNameRef() const
+{
+	return _name.ref();
+}
+
+void AbstractFileSystem::Node::setEtag(const std::string &etag)
+{
+	_etag=etag;
+}
+
+ContentManager::Version AbstractFileSystem::Node::getVersion() const
+{
+	ContentManager::Version ret;
+	ret.md5=_md5;
+	ret.etag=_etag.str();
+	ret.modified=_unpackTime(_times[ModificationTime]);
+	if(static_cast<NodeType>(_fileType)==NodeType::Exported)
+		ret.format=_tree->cloudExportFormat(*this);
+	return ret;
+}
+
 void AbstractFileSystem::Node::setFileType(NodeType type)
 {
-	_fileType=type;
+	_fileType=static_cast<uint8_t>(type);
 }
 
 size_t AbstractFileSystem::Node::size() const
@@ -360,11 +509,23 @@ size_t AbstractFileSystem::Node::size() const
 	return _size;
 }
 
+AbstractFileSystem *AbstractFileSystem::Node::getTree()
+{
+	return _tree;
+}
+
 AbstractFileSystem::Node *AbstractFileSystem::Node::getParent()
 {
 	return _parent;
 }
 
+fs::path AbstractFileSystem::Node::getPath()
+{
+	if(!_parent)
+		return ROOT_PATH;
+	return _parent->getPath()/_name.str();
+}
+
 void AbstractFileSystem::Node::removeNodes(Node *what)
 {
 	NodeList::iterator it=begin(),itEnd=end();
@@ -375,6 +536,7 @@ void AbstractFileSystem::Node::removeNodes(Node *what)
 
 		it->removeNodes(nullptr);
 		_tree->cloudRemove(*it);
+		_tree->_unindex(&*it,false);
 		if(!it->isFolder())
 			_tree->_cm->deleteFile(it->getId());
 		_tree->_notifier->onNodeRemove(*it);
@@ -382,10 +544,17 @@ void AbstractFileSystem::Node::removeNodes(Node *what)
 		if(what)
 			break;
 	}
-	if(what)
-		_next.erase(it);
-	else
-		_next.clear();
+	// removed files could be open yet
+	if(!what)
+		it=begin();
+	while(it!=itEnd)
+	{
+		Node *n=_next.release(it++).release();
+		n->_parent=nullptr;
+		_tree->_dispose(n);
+		if(what)
+			break;
+	}
 }
 
 AbstractFileSystem::Node *AbstractFileSystem::Node::find(fs::path::iterator &it,const fs::path::iterator &end)
@@ -393,28 +562,27 @@ AbstractFileSystem::Node *AbstractFileSystem::Node::find(fs::path::iterator &it,
 	AbstractFileSystem::Node *ret=this;
 	for(;it!=end;++it)
 	{
-		AbstractFileSystem::Node::iterator itNext=std::find_if(ret->_next.begin(),ret->_next.end(),
-										   [&it](AbstractFileSystem::Node &n){return n.getName()==*it;});
-		if(itNext==ret->_next.end())
+		AbstractFileSystem::Node *next=ret->findChild(it->native());
+		if(!next)
 			break;
-		ret=&*itNext;
+		ret=next;
 	}
 	return ret;
 }
 
-void AbstractFileSystem::Node::clearTime(TimeAttrib what)
+AbstractFileSystem::Node *AbstractFileSystem::Node::findChild(boost::string_ref name)
 {
-	timespec *p=&_lastAccess;
-	switch(what)
+	for(Node &n : _next)
 	{
-	case TimeAttrib::ModificationTime:
-		p=&_lastModification;
-		break;
-	case TimeAttrib::ChangeTime:
-		p=&_lastChange;
-		break;
+		if(n._name.ref()==name)
+			return &n;
 	}
-	memset(p,0,sizeof(timespec));
+	return nullptr;
+}
+
+void AbstractFileSystem::Node::clearTime(TimeAttrib what)
+{
+	_times[what]=0;
 }
 
 void AbstractFileSystem::Node::addNext(Node *value)
@@ -431,27 +599,16 @@ bool AbstractFileSystem::Node::importNreplace(INode &value,const fs::path &newNa
 	if(toReplace)
 	{
 		assert(toReplace->_parent==this);
-		// Value is from our filesystem
-		if(v && v->_tree==_tree)
-		{
-			_tree->cloudRemove(*toReplace);
-			_tree->_notifier->onNodeRemove(*toReplace);
-			auto p=toReplace->patch(*v,Field::Parent|Field::Name|Field::Id|Field::Time|Field::Content);
-			_tree->cloudUpdate(*toReplace,p);
-			_tree->_notifier->onNodeChange(*toReplace,p);
-		}
-		else
-		{
-			// TODO Make via update instead delete/create
-			auto it=std::find_if(_next.begin(),_next.end(),[&](const auto &e){ return &e==toReplace; });
-			if(it!=_next.end())
-			{
-				_tree->cloudRemove(*toReplace);
-				_tree->_notifier->onNodeRemove(*toReplace);
-				_next.erase(it);
-			}
-		}
+		// TODO Make via update instead delete/create
+		removeNodes(toReplace);
 	}
+	// Copy within cloud is made by server
+	if(v && _tree->isSameCloud(*v->_tree))
+	{
+		_tree->_copy(*v,this,newName);
+		return true;
+	}
+
 	uptr<Node> n(new Node(_tree,this));
 	if(newName.empty())
 		n->setName(value.getName());
@@ -466,6 +623,7 @@ bool AbstractFileSystem::Node::importNreplace(INode &value,const fs::path &newNa
 	_tree->_notifier->onNodeCreate(*n);
 	Node *nn=n.release();
 	_next.push_back(nn);
+	_tree->_index(nn);
 	_tree->_notifier->onDirChange(*this,INotifier::Added,*nn);
 
 	if(value.isFolder())
@@ -477,30 +635,7 @@ bool AbstractFileSystem::Node::importNreplace(INode &value,const fs::path &newNa
 		}
 	}
 	else
-	{
-		// TODO Change open flags on something independent from POSIX
-		size_t size=value.getSize();
-		if(size)
-		{
-			uptr<IContentHandle> hSource(value.openContent(O_RDONLY));
-			uptr<IContentHandle> hDest(nn->openContent(O_CREAT));
-
-			char buf[4096];
-			off_t offset=0;
-			int readed=0;
-			while(size!=0 && (readed=hSource->read(buf,sizeof(buf),offset))!=0)
-			{
-				if(readed==-1)
-					G2F_EXCEPTION("Can't read imported file '%1'").arg(value.getName()).throwItSystem(hSource->getError());
-				offset+=readed;
-				if(hDest->write(buf,readed,offset)==-1)
-					G2F_EXCEPTION("Can't write imported file '%1'").arg(value.getName()).throwItSystem(hDest->getError());
-
-			}
-			hDest->close();
-			hSource->close();
-		}
-	}
+		copyContent(value,*nn);
 	return true;
 }
 
@@ -536,20 +671,13 @@ int AbstractFileSystem::Node::patch(Node &dataSource,int patchField)
 
 	if(patchField & Time)
 	{
-		if(this->_lastAccess!=dataSource._lastAccess)
-		{
-			this->_lastAccess=dataSource._lastAccess;
-			ret|=Time;
-		}
-		if(this->_lastChange!=dataSource._lastChange)
-		{
-			this->_lastChange=dataSource._lastChange;
-			ret|=Time;
-		}
-		if(this->_lastModification!=dataSource._lastModification)
+		for(size_t i=0;i<sizeof(_times)/sizeof(_times[0]);++i)
 		{
-			this->_lastModification=dataSource._lastModification;
-			ret|=Time;
+			if(this->_times[i]!=dataSource._times[i])
+			{
+				this->_times[i]=dataSource._times[i];
+				ret|=Time;
+			}
 		}
 	}
 
@@ -603,6 +731,7 @@ AbstractFileSystem::AbstractFileSystem(const ContentManagerPtr &cm)
 	_cache.reset(new Cache);
 	_notifier.reset(new Notifier(this));
 	//_notifier->subscribeToContentChange(IFileSystem::INotify::OnContentChange::slot_type(&AbstractFileSystem::updateNodeContent,this));
+	using namespace boost::placeholders;
 	_notifier->subscribeToFileContentChange(boost::bind(&AbstractFileSystem::updateNodeContent,this,_1));
 	_notifier->subscribeToNodeRemove(boost::bind(&Cache::slotNodeRemoved,_cache.get(),_1));
 	_notifier->subscribeToNodeChange(boost::bind(&Cache::slotNodeChanged,_cache.get(),_1,_2));
@@ -615,24 +744,70 @@ AbstractFileSystem::~AbstractFileSystem()
 
 void AbstractFileSystem::fillDir(Node *dir)
 {
-	if(!dir->isFolder())
-		return;
+	std::string id;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_treeM);
+		if(!dir->isFolder())
+			return;
+		id=dir->getId();
+	}
+	fillDir(id);
+}
 
-	if(dir->_dirFilled)
+bool AbstractFileSystem::fillDir(const std::string &dirId)
+{
+	bool wasFilled=false;
 	{
-		dir->_next.clear();
-		dir->_dirFilled=false;
+		std::lock_guard<std::recursive_mutex> lock(_treeM);
+		Node *dir=findById(dirId);
+		if(!dir)
+			return false;
+		if(!dir->isFolder())
+			return true;
+		wasFilled=dir->_dirFilled;
 	}
 
-	const auto& ids=cloudFetchChildrenList(dir->getId());
+	// cloud is requested without lock, so other directories could be filled meanwhile
+	Node::NodeList fetched;
+	const auto& ids=cloudFetchChildrenList(dirId);
 	for(const auto &id : ids)
 	{
-		uptr<Node> nn(new Node(this,dir));
+		uptr<Node> nn(new Node(this,nullptr));
 		nn->setId(id);
 		cloudFetchMeta(*nn);
-		dir->addNext(nn.release());
+		fetched.push_back(nn.release());
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	// directory could be removed meanwhile, so it's looked up again
+	Node *dir=findById(dirId);
+	if(!dir)
+		return false;
+	// has been filled by concurrent request
+	if(!wasFilled && dir->_dirFilled)
+		return true;
+	// old children are replaced by fetched ones, cached paths mustn't refer to them
+	while(!dir->_next.empty())
+	{
+		Node *n=dir->_next.release(dir->_next.begin()).release();
+		n->_parent=nullptr;
+		_notifyRemoved(*n,false);
+		_unindex(n,true);
+		_dispose(n);
+	}
+	for(Node &n : fetched)
+	{
+		n._parent=dir;
+		_index(&n);
 	}
+	dir->_next.transfer(dir->_next.end(),fetched);
 	dir->_dirFilled=true;
+	return true;
+}
+
+std::recursive_mutex &AbstractFileSystem::getTreeMutex()
+{
+	return _treeM;
 }
 
 // IData interface
@@ -648,45 +823,259 @@ AbstractFileSystem::Node *AbstractFileSystem::getRoot()
 		_root=std::make_shared<AbstractFileSystem::Node>(this,nullptr);
 		_root->setId("root");
 		cloudFetchMeta(*_root);
+		// children refer to real id of root
+		_rootId=_root->getId();
 		_root->setId("root");
 		_root->setName("/");
+		_index(_root.get());
 	}
 	return _root.get();
 }
 
+AbstractFileSystem::Node *AbstractFileSystem::findById(const std::string &id)
+{
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	auto it=_byId.find(id==_rootId ? std::string("root") : id);
+	return it!=_byId.end() ? it->second : nullptr;
+}
+
+bool AbstractFileSystem::bootstrap()
+{
+	Node *root=getRoot();
+	// changes made during listing will be applied later
+	std::string token;
+	Changes none;
+	cloudFetchChanges(token,none);
+
+	Changes all;
+	if(!cloudFetchAll(all))
+		return false;
+
+	std::unordered_map<std::string,std::vector<Change*>> children;
+	for(Change &c : all)
+	{
+		if(!c.removed && c.meta)
+			children[c.parentId==_rootId ? std::string("root") : c.parentId].push_back(&c);
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	while(!root->_next.empty())
+	{
+		Node *n=root->_next.release(root->_next.begin()).release();
+		n->_parent=nullptr;
+		_notifyRemoved(*n,false);
+		_unindex(n,true);
+		_dispose(n);
+	}
+
+	// breadth-first from root: nodes unreachable from root (e.g. shared with me) are dropped
+	std::vector<Node*> dirs{root};
+	while(!dirs.empty())
+	{
+		Node *dir=dirs.back();
+		dirs.pop_back();
+		auto it=children.find(dir->getId());
+		if(it!=children.end())
+		{
+			for(Change *c : it->second)
+			{
+				Node *n=c->meta.release();
+				n->_parent=dir;
+				dir->_next.push_back(n);
+				_index(n);
+				if(n->isFolder())
+					dirs.push_back(n);
+			}
+		}
+		dir->_dirFilled=true;
+	}
+	_changeToken=token;
+	return true;
+}
+
+void AbstractFileSystem::syncChanges()
+{
+	std::string token;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_treeM);
+		token=_changeToken;
+	}
+	Changes changes;
+	if(!cloudFetchChanges(token,changes))
+		return;
+	for(Change &c : changes)
+		_applyChange(c);
+
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	_changeToken=token;
+}
+
+void AbstractFileSystem::_index(Node *n)
+{
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	_byId[n->getId()]=n;
+}
+
+void AbstractFileSystem::_unindex(Node *n,bool recursive)
+{
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	auto it=_byId.find(n->getId());
+	if(it!=_byId.end() && it->second==n)
+		_byId.erase(it);
+	if(recursive)
+	{
+		for(Node &child : *n)
+			_unindex(&child,true);
+	}
+}
+
+void AbstractFileSystem::_notifyRemoved(Node &n,bool dropContent)
+{
+	for(Node &child : n)
+		_notifyRemoved(child,dropContent);
+	if(dropContent && !n.isFolder())
+		_cm->deleteFile(n.getId());
+	_notifier->onNodeRemove(n);
+}
+
+void AbstractFileSystem::_dispose(Node *n)
+{
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	if(_isOpened(*n))
+		_removed.push_back(n);
+	else
+		delete n;
+}
+
+void AbstractFileSystem::_releaseHandle(Node *n)
+{
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	if(--n->_handles || _removed.empty())
+		return;
+	Node *top=n;
+	while(top->_parent)
+		top=top->_parent;
+	auto it=std::find_if(_removed.begin(),_removed.end(),[&](const Node &e){ return &e==top; });
+	if(it!=_removed.end() && !_isOpened(*top))
+		_removed.erase(it);
+}
+
+bool AbstractFileSystem::_isOpened(const Node &n)
+{
+	if(n._handles)
+		return true;
+	for(const Node &child : n)
+	{
+		if(_isOpened(child))
+			return true;
+	}
+	return false;
+}
+
+void AbstractFileSystem::_applyChange(Change &c)
+{
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	Node *n=findById(c.id);
+	Node *parent=c.removed ? nullptr : findById(c.parentId);
+	// moved out of loaded part of tree is same as removed
+	if(c.removed || (n && !parent))
+	{
+		parent=n ? n->_parent : nullptr;
+		if(!parent)
+			return;
+		_notifyRemoved(*n,true);
+		_unindex(n,true);
+		parent->detachNode(n);
+		_dispose(n);
+		_notifier->onDirChange(*parent,INotifier::Remove,*n);
+		return;
+	}
+
+	if(!c.meta)
+		return;
+	if(!n)
+	{
+		// content of not loaded directories will be fetched on demand
+		if(parent && parent->_dirFilled)
+		{
+			Node *nn=c.meta.release();
+			nn->_parent=parent;
+			parent->_next.push_back(nn);
+			_index(nn);
+			_notifier->onNodeCreate(*nn);
+			_notifier->onDirChange(*parent,INotifier::Added,*nn);
+		}
+		return;
+	}
+
+	Node &m=*c.meta;
+	const fs::path &oldPath=n->getPath();
+	int fields=n->patch(m,Node::Name|Node::Time);
+	if(n->_md5!=m._md5 || n->_size!=m._size || n->_etag!=m._etag)
+	{
+		n->_md5=m._md5;
+		n->_size=m._size;
+		n->_etag=m._etag;
+		fields|=Node::Content;
+	}
+	if(n->_parent && parent!=n->_parent)
+	{
+		n->_parent->detachNode(n);
+		parent->attachNode(n);
+		fields|=Node::Parent;
+	}
+	if(fields & (Node::Name|Node::Parent))
+		_cache->invalidate(oldPath.string());
+	if(fields)
+		_notifier->onNodeChange(*n,fields);
+}
+
 INode *AbstractFileSystem::get(const fs::path &path)
 {
-	if(path==ROOT_PATH)
+	return find(path.native());
+}
+
+INode *AbstractFileSystem::find(boost::string_ref path)
+{
+	if(path.empty() || path==ROOT_PATH.native())
 		return getRoot();
 
 	if(INode *in=_cache->findByPath(path))
 		return in;
 
-	fs::path::iterator it=path.begin();
-	AbstractFileSystem::Node *n=getRoot()->find(++it,path.end());
-	if(it==path.end())
-	{
-		_cache->insert(path,n->getId(),n);
-		return n;
-	}
-	if(!n->_dirFilled)
+	// Walks path by components without building of fs::path. Children are looked up under tree lock,
+	// it's released while directory is filled from cloud
+	AbstractFileSystem::Node *n=getRoot();
+	std::unique_lock<std::recursive_mutex> lock(_treeM);
+	size_t pos=0;
+	while(pos<path.size())
 	{
-		while(it!=path.end() && n->isFolder())
+		size_t end=std::find(path.begin()+pos,path.end(),'/')-path.begin();
+		const boost::string_ref &name=path.substr(pos,end-pos);
+		pos=end+1;
+		if(name.empty())
+			continue;
+
+		if(!n->isFolder())
+			return 0;
+		if(!n->_dirFilled)
 		{
-			fillDir(n);
-			AbstractFileSystem::Node::iterator itNext=std::find_if(n->begin(),n->end(),
-											[&](AbstractFileSystem::Node& node){ return *it==node.getName(); });
-			if(itNext==n->end())
-				break;
-			AbstractFileSystem::Node *next=&*itNext;
-			_cache->insert(fromPathIt(path.begin(),++it),next->getId(),next);
-			n=next;
+			// directory could be removed or refilled meanwhile, so it's looked up again
+			const std::string id=n->getId();
+			lock.unlock();
+			fillDir(id);
+			lock.lock();
+			n=findById(id);
+			if(!n)
+				return 0;
 		}
-		// We have gone this way
-		if(it==path.end())
-			return n;
+		AbstractFileSystem::Node *next=n->findChild(name);
+		if(!next)
+			return 0;
+		n=next;
 	}
-	return 0;
+	_cache->insert(path,n->getId(),n);
+	return n;
 }
 
 IFileSystem::CreateResult AbstractFileSystem::createNode(const fs::path &path,bool isDirectory)
@@ -710,6 +1099,7 @@ IFileSystem::CreateResult AbstractFileSystem::createNode(const fs::path &path,bo
 
 		cloudCreateMeta(*nn);
 		n->addNext(nn.get());
+		_index(nn.get());
 		n=nn.release();
 
 		--entries;
@@ -758,7 +1148,10 @@ void AbstractFileSystem::renameNode(const boost::filesystem::path &oldPath, cons
 	if(newParentNode!=oldParentNode)
 		patchFields|=Node::Field::Parent;
 	cloudUpdate(*oldNode,patchFields);
+	// paths of whole subtree are changed
+	_cache->invalidate(oldPath.string());
 	_notifier->onNodeChange(*oldNode,patchFields);
+	_updatePins(*oldNode);
 
 	// then remove newNode (completely - from cloud and tree)
 	if(newNode)
@@ -770,9 +1163,8 @@ void AbstractFileSystem::replaceNode(const boost::filesystem::path &pathToReplac
 {
 	Node *node=getNode(pathToReplace,true);
 	Node *base=node->getParent();
-	bool changed=base->importNreplace(onThis,fs::path(),node);
-	if(changed)
-		this->_notifier->onNodeChange(*node,-1);
+	// replaced node is removed, its place is taken by created one
+	base->importNreplace(onThis,pathToReplace.filename(),node);
 }
 
 void AbstractFileSystem::insertNode(const fs::path &parentPath, INode &that)
@@ -800,5 +1192,409 @@ void AbstractFileSystem::updateNodeContent(INode &n)
 	const ContentManager::IReaderPtr &reader=_cm->readContent(node->getId());
 	cloudUpdate(*node,{},"",reader.get());
 	cloudFetchMeta(*node);
+	_cm->storeContent(node->getId(),node->getMD5());
+	_cm->setVersion(node->getId(),node->getVersion());
+	_cm->setPinned(node->getId(),isPinnedPath(node->getPath()));
+}
+
+WorkerPoolPtr AbstractFileSystem::createBackgroundPool(IConfiguration &conf,size_t threads,bool idleIO)
+{
+	WorkerPoolPtr ret=std::make_shared<WorkerPool>(threads,idleIO);
+	ret->setTaskBudget(getPropertyAs<size_t>(conf,"op_deadline",60)*1000);
+	return ret;
+}
+
+AbstractFileSystem::SharedResources AbstractFileSystem::SharedResources::create(IConfiguration &conf)
+{
+	SharedResources ret;
+	if(size_t threads=getPropertyAs<size_t>(conf,"download_threads",0))
+		ret.downloadPool=createBackgroundPool(conf,threads);
+	if(getPropertyAs<std::string>(conf,"cache_prefetch_strategy","")=="eager")
+		ret.prefetchPool=createBackgroundPool(conf,getPropertyAs<size_t>(conf,"prefetch_threads",1));
+	ret.cacheBudget=std::make_shared<ContentManager::Budget>();
+	return ret;
+}
+
+void AbstractFileSystem::configureCache(IConfiguration &conf,const SharedResources &shared)
+{
+	ContentManager::Limits limits;
+	limits.maxBytes=getPropertyAs<uint64_t>(conf,"cache_max_size",0)*1024*1024;
+	limits.maxFiles=getPropertyAs<size_t>(conf,"cache_max_files",0);
+	if(getPropertyAs<std::string>(conf,"cache_eviction_policy","")=="lfu")
+		limits.policy=ContentManager::EvictionPolicy::LFU;
+	_cm->setLimits(limits);
+
+	ContentManager::IOOptions io;
+	io.directIO=getPropertyAs<bool>(conf,"cache_direct_io",false);
+	io.preallocate=getPropertyAs<bool>(conf,"cache_preallocate",true);
+	_cm->setIOOptions(io);
+
+	if(getPropertyAs<std::string>(conf,"cache_prefetch_strategy","")=="eager")
+	{
+		_prefetchDepth=getPropertyAs<size_t>(conf,"prefetch_depth",1);
+		_prefetchBreadth=getPropertyAs<size_t>(conf,"prefetch_breadth",0);
+		WorkerPoolPtr pool=shared.prefetchPool;
+		if(!pool)
+			pool=createBackgroundPool(conf,getPropertyAs<size_t>(conf,"prefetch_threads",1));
+		_prefetchPool.reset(new WorkerPool::Scope(pool));
+	}
+	_copyThreads=getPropertyAs<size_t>(conf,"copy_threads",1);
+	_exportSizeEstimate=getPropertyAs<uint64_t>(conf,"export_size_estimate",0)*1024;
+	size_t downloadThreads=getPropertyAs<size_t>(conf,"download_threads",0);
+	if(downloadThreads && !_downloadPool)
+	{
+		WorkerPoolPtr pool=shared.downloadPool;
+		if(!pool)
+			pool=createBackgroundPool(conf,downloadThreads);
+		_downloadPool.reset(new WorkerPool::Scope(pool));
+	}
+	if(shared.cacheBudget)
+		_cm->setBudget(shared.cacheBudget);
+}
+
+void AbstractFileSystem::_copy(Node &source,Node *destDir,const fs::path &newName)
+{
+	std::exception_ptr error;
+	WorkerPool pool(_copyThreads);
+	try
+	{
+		_copyNode(source,destDir,newName,pool,error);
+	}
+	catch(...)
+	{
+		std::lock_guard<std::recursive_mutex> lock(_treeM);
+		if(!error)
+			error=std::current_exception();
+	}
+	// tasks refer to error
+	pool.wait();
+	if(error)
+		std::rethrow_exception(error);
+}
+
+void AbstractFileSystem::_copyNode(Node &source,Node *destDir,const fs::path &newName,WorkerPool &pool,std::exception_ptr &error)
+{
+	uptr<Node> n(new Node(this,destDir));
+	n->setName(newName.empty() ? source.getName() : newName);
+	n->setFileType(source.getNodeType());
+	n->setTime(TimeAttrib::AccessTime,source.getTime(TimeAttrib::AccessTime));
+	n->setTime(TimeAttrib::ModificationTime,source.getTime(TimeAttrib::ModificationTime));
+	n->setTime(TimeAttrib::ChangeTime,source.getTime(TimeAttrib::ChangeTime));
+
+	if(!source.isFolder())
+	{
+		// Files are copied in parallel, folders structure is built meanwhile
+		Node *nn=n.release();
+		pool.post([this,&source,destDir,nn,&error]
+		{
+			uptr<Node> n(nn);
+			try
+			{
+				if(cloudCopy(source,*n))
+					_attach(destDir,n.release());
+				else
+				{
+					cloudCreateMeta(*n);
+					Node *created=n.release();
+					_attach(destDir,created);
+					copyContent(source,*created);
+				}
+			}
+			catch(...)
+			{
+				std::lock_guard<std::recursive_mutex> lock(_treeM);
+				if(!error)
+					error=std::current_exception();
+			}
+		});
+		return;
+	}
+
+	cloudCreateMeta(*n);
+	Node *nn=n.release();
+	_attach(destDir,nn);
+	// source could be node of other file system of the same cloud
+	AbstractFileSystem &from=*source._tree;
+	if(!source._dirFilled)
+		from.fillDir(&source);
+
+	std::vector<Node*> children;
+	{
+		std::lock_guard<std::recursive_mutex> lock(from._treeM);
+		nn->_dirFilled=true;
+		for(Node &child : source)
+		{
+			// copy into itself
+			if(&child!=nn)
+				children.push_back(&child);
+		}
+	}
+	for(Node *child : children)
+		_copyNode(*child,nn,fs::path(),pool,error);
+}
+
+void AbstractFileSystem::_attach(Node *dir,Node *n)
+{
+	{
+		std::lock_guard<std::recursive_mutex> lock(_treeM);
+		n->_parent=dir;
+		dir->_next.push_back(n);
+		_index(n);
+	}
+	_notifier->onNodeCreate(*n);
+	_notifier->onDirChange(*dir,INotifier::Added,*n);
+}
+
+void AbstractFileSystem::_prefetchChildren(const std::string &dirId, size_t depth)
+{
+	if(!depth)
+		return;
+
+	size_t posted=0;
+	std::lock_guard<std::recursive_mutex> lock(_treeM);
+	Node *dir=findById(dirId);
+	if(!dir)
+		return;
+	for(Node &child : *dir)
+	{
+		if(_prefetchBreadth && posted>=_prefetchBreadth)
+			break;
+		if(!child.isFolder() || child._dirFilled)
+			continue;
+		// directory could be removed before the task runs
+		const std::string id=child.getId();
+		_prefetchPool->post([this,id,depth]
+		{
+			{
+				std::lock_guard<std::recursive_mutex> lock(_treeM);
+				Node *c=findById(id);
+				if(!c || c->_dirFilled)
+					return;
+			}
+			if(fillDir(id))
+				_prefetchChildren(id,depth-1);
+		});
+		++posted;
+	}
+}
+
+AbstractFileSystem::ContentAccess AbstractFileSystem::_accessContent(Node &n,bool start)
+{
+	// Fields of node are changed by change feed, download works with their snapshot
+	sptr<Node> node=std::make_shared<Node>(this,nullptr);
+	fs::path path;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_treeM);
+		node->_id=n._id;
+		node->_name=n._name;
+		node->_size=n._size;
+		node->_md5=n._md5;
+		node->_etag=n._etag;
+		node->_fileType=n._fileType;
+		std::copy(std::begin(n._times),std::end(n._times),std::begin(node->_times));
+		path=n.getPath();
+	}
+	const std::string id=node->getId();
+	const uint64_t size=node->_size;
+	// size of exported content is known after export only
+	const bool exported=node->getNodeType()==INode::NodeType::Exported;
+	const MD5Signature md5=node->_md5;
+	const ContentManager::Version version=node->getVersion();
+	const bool pinned=isPinnedPath(path);
+
+	ContentAccess ret;
+	ContentDownloadPtr download;
+	{
+		std::lock_guard<std::mutex> lock(_downloadsM);
+		auto it=_downloads.find(id);
+		if(it!=_downloads.end())
+		{
+			ret.download=it->second;
+			return ret;
+		}
+		if(_cm->is(id))
+		{
+			// Local changes win over remote ones until they are uploaded
+			if(_cm->isDirty(id) || _cm->isActual(id,version))
+			{
+				ret.cached=true;
+				return ret;
+			}
+			// Remote content has been changed
+			_cm->deleteFile(id);
+		}
+		if(!start)
+			return ret;
+		// Same content could be downloaded already for another node
+		if(_cm->shareContent(id,md5))
+		{
+			_cm->setVersion(id,version);
+			_cm->setPinned(id,pinned);
+			ret.cached=true;
+			return ret;
+		}
+		// empty file is opened at once, download fills it in place. It isn't evicted until filled
+		_cm->beginDownload(id);
+		try
+		{
+			_cm->createFile(id,nullptr);
+		}
+		catch(...)
+		{
+			_cm->endDownload(id);
+			throw;
+		}
+		download=std::make_shared<ContentDownload>(size);
+		_downloads[id]=download;
+	}
+
+	ret.download=download;
+	ret.task=[=]
+	{
+		posix_error_code err=0;
+		try
+		{
+			const uint64_t written=_cm->createFile(id,cloudReadMedia(*node).get(),exported ? ContentManager::UNKNOWN_SIZE : size,[download](uint64_t frontier)
+			{
+				download->advance(frontier);
+			});
+			MD5Signature contentMd5=md5;
+			ContentManager::Version contentVersion=version;
+			if(!exported && written!=size)
+			{
+				// File is changed in cloud since its metadata were fetched. They are refreshed once,
+				// content is taken if it corresponds to the actual ones
+				cloudFetchMeta(*node);
+				if(node->_size!=written)
+					G2F_EXCEPTION("Content of id '%1' is %2 bytes, but file is %3 bytes").arg(id).arg(written).arg(node->_size).throwItSystem(EIO);
+				contentMd5=node->_md5;
+				contentVersion=node->getVersion();
+			}
+			if(exported || written!=size)
+			{
+				// node could be removed or changed by change feed meanwhile
+				std::lock_guard<std::recursive_mutex> lock(_treeM);
+				Node *current=findById(id);
+				if(current && current->getVersion().isSame(version))
+				{
+					current->_size=written;
+					if(!exported)
+					{
+						current->_md5=node->_md5;
+						current->_etag=node->_etag;
+						current->_times[ModificationTime]=node->_times[ModificationTime];
+						_notifier->onNodeChange(*current,Node::Content);
+					}
+				}
+			}
+			_cm->storeContent(id,contentMd5);
+			_cm->setVersion(id,contentVersion);
+			_cm->setPinned(id,pinned);
+		}
+		catch(const G2FException &e)
+		{
+			G2F_LOG("Download of '" << id << "' failed: " << e.what());
+			err=e.code().default_error_condition().value();
+		}
+		catch(const std::exception &e)
+		{
+			G2F_LOG("Download of '" << id << "' failed: " << e.what());
+			err=EIO;
+		}
+		if(err)
+		{
+			// partial content mustn't be taken for actual one
+			try
+			{
+				_cm->deleteFile(id);
+			}
+			catch(...)
+			{}
+		}
+		_cm->endDownload(id);
+		{
+			std::lock_guard<std::mutex> lock(_downloadsM);
+			_downloads.erase(id);
+		}
+		download->finish(err);
+	};
+	return ret;
+}
+
+bool AbstractFileSystem::prefetchContent(const std::string &id,uint64_t &size)
+{
+	ContentAccess access;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_treeM);
+		Node *n=findById(id);
+		if(!n || n->isFolder())
+			return false;
+		access=_accessContent(*n,true);
+	}
+	if(access.task)
+		access.task();
+	if(access.download)
+	{
+		if(posix_error_code err=access.download->wait())
+			G2F_EXCEPTION("Download of content of id '%1' failed").arg(id).throwItSystem(err);
+	}
+	size=_cm->getCachedSize(id);
+	return true;
+}
+
+ContentDownloadPtr AbstractFileSystem::_startDownload(Node &n,bool background)
+{
+	const ContentAccess &access=_accessContent(n,true);
+	if(access.task)
+	{
+		if(background && _downloadPool)
+			_downloadPool->post(access.task);
+		else
+			access.task();
+	}
+	return access.download;
+}
+
+void AbstractFileSystem::setPinnedPaths(const std::vector<fs::path> &paths)
+{
+	{
+		std::lock_guard<std::mutex> lock(_pinnedM);
+		_pinned=paths;
+	}
+	// only loaded part of tree could have cached content
+	_updatePins(*getRoot());
+}
+
+std::vector<fs::path> AbstractFileSystem::getPinnedPaths()
+{
+	std::lock_guard<std::mutex> lock(_pinnedM);
+	return _pinned;
+}
+
+bool AbstractFileSystem::isPinnedPath(const fs::path &path)
+{
+	std::lock_guard<std::mutex> lock(_pinnedM);
+	for(const fs::path &p : _pinned)
+	{
+		if(std::mismatch(p.begin(),p.end(),path.begin(),path.end()).first==p.end())
+			return true;
+	}
+	return false;
+}
+
+ContentManager &AbstractFileSystem::getContentManager()
+{
+	return *_cm;
+}
+
+void AbstractFileSystem::_updatePins(Node &n)
+{
+	if(!n.isFolder())
+	{
+		_cm->setPinned(n.getId(),isPinnedPath(n.getPath()));
+		return;
+	}
+	for(Node &child : n)
+		_updatePins(child);
 }
 
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <string>
+#include <mutex>
+#include <unordered_map>
 #include <boost/ptr_container/ptr_list.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include "utils/decls.h"
 #include "IFileSystem.h"
 #include "cache/Cache.h"
 #include "control/IConfiguration.h"
 #include "ContentManager.h"
+#include "ContentDownload.h"
+#include "utils/WorkerPool.h"
+#include "utils/CompactString.h"
 
 
 /**
@@ -62,14 +68,25 @@ public:
 
 		MD5Signature getMD5();
 		void setMD5(const MD5Signature &md5);
+		std::string getEtag() const;
+		// Allocation free accessors (valid while node isn't changed)
+		boost::string_ref getIdRef() const;
+		boost::string_ref getNameRef() const;
+		void setEtag(const std::string &etag);
+		// Remote version of content
+		ContentManager::Version getVersion() const;
 		void setFileType(NodeType type);
+		AbstractFileSystem *getTree();
 		Node *getParent();
+		fs::path getPath();
+		bool isFilled() const;
 
 		// Remove all (what==null) or particular (what!=null) inferrior nodes
 		void removeNodes(Node *what=nullptr);
 
 		size_t size() const;
 		Node *find(fs::path::iterator &it,const fs::path::iterator &end);
+		Node *findChild(boost::string_ref name);
 		void clearTime(TimeAttrib what);
 		void addNext(Node *value);
 		bool importNreplace(INode &value, const fs::path &newName=fs::path(), Node *toReplace=nullptr);
@@ -82,33 +99,83 @@ public:
 		inline iterator end() { return _next.end(); }
 		inline const_iterator end() const { return _next.end(); }
 
+		// Nodes are allocated from pool: trees of millions nodes are fragmenting heap
+		static void *operator new(size_t size);
+		static void operator delete(void *p,size_t size);
+
 	private:
 		class FileHandle;
 
+		void _fetchContent();
+		bool _isContentCached();
+
+		// timespec packed into 64 bits: 34 bits of seconds (up to year 2514) and 30 bits of nanoseconds
+		static uint64_t _packTime(const timespec &ts);
+		static timespec _unpackTime(uint64_t packed);
+
+		// Fields are ordered to avoid padding (node per file of whole drive is kept in memory)
 		AbstractFileSystem *_tree=nullptr;
-		bool _dirFilled=false;
-		NodeList _next;
-		std::string _id;
-		fs::path _name;
-		size_t _size = 0;
-		NodeType _fileType=NodeType::Binary;
-		MD5Signature _md5;
 		Node *_parent=0;
+		NodeList _next;
+		uint64_t _size = 0;
+		uint64_t _times[3]={}; // indexed by TimeAttrib
+		MD5Signature _md5{};
+		// Drive ids are 28 or 33 chars, typical names and short etags fit inline too
+		CompactString<33> _id;
+		CompactString<23> _name;
+		CompactString<16> _etag;
+		uint8_t _fileType=static_cast<uint8_t>(NodeType::Binary);
+		bool _dirFilled=false;
+		// Open handles of file (guarded by tree lock)
+		uint16_t _handles=0;
+	};
 
-		timespec _lastAccess;        // time of last access
-		timespec _lastModification;  // time of last modification
-		timespec _lastChange;        // time of last status change
+	/**
+	 * @brief State of node in cloud (for bulk loading and change feed)
+	 *
+	 ************************************/
+	struct Change
+	{
+		std::string id;
+		bool removed=false;
+		// Actual metadata (for not removed node)
+		uptr<Node> meta;
+		std::string parentId;
 	};
+	typedef std::vector<Change> Changes;
+
+	/**
+	 * @brief Resources shared by file systems of accounts served by one process
+	 *
+	 * Null members are created by each file system for itself
+	 ************************************/
+	struct SharedResources
+	{
+		WorkerPoolPtr downloadPool;
+		WorkerPoolPtr prefetchPool;
+		ContentManager::BudgetPtr cacheBudget;
+
+		// Creates all resources by global configuration
+		static SharedResources create(IConfiguration &conf);
+	};
+
+	// Pool of work outliving file operations, its tasks have own budget of 'op_deadline'
+	static WorkerPoolPtr createBackgroundPool(IConfiguration &conf,size_t threads,bool idleIO=false);
 
 public:
 	AbstractFileSystem(const ContentManagerPtr &cm);
 	~AbstractFileSystem();
 
 	void fillDir(Node *dir);
+	// Directory is looked up by id before and after cloud request. Returns false if it isn't in tree
+	bool fillDir(const std::string &dirId);
+	// Guards structure of tree (list of children)
+	std::recursive_mutex &getTreeMutex();
 
 	virtual INotifier *getNotifier() override;
 	virtual Node *getRoot() override;
 	virtual INode *get(const fs::path &path) override;
+	virtual INode *find(boost::string_ref path) override;
 	virtual CreateResult createNode(const fs::path &path,bool isDirectory) override;
 	virtual RemoveStatus removeNode(const fs::path &path) override;
 	virtual void renameNode(const boost::filesystem::path &oldPath, const boost::filesystem::path &newPath) override;
@@ -116,6 +183,25 @@ public:
 	virtual void insertNode(const fs::path &parentPath,INode &that);
 
 	Node *getNode(const fs::path &path,bool throwIfMissed);
+	// Looks for node among loaded part of tree
+	Node *findById(const std::string &id);
+	// Downloads content of file into cache (if it's absent or stale). File is looked up by id under tree lock
+	// and download works with snapshot of node, so file could be removed meanwhile. Returns false if there
+	// isn't such file, 'size' receives size of cached content
+	bool prefetchContent(const std::string &id,uint64_t &size);
+
+	// Loads metadata of whole tree at once. Returns false if cloud doesn't support it
+	bool bootstrap();
+	// Applies changes made in cloud since previous call
+	void syncChanges();
+
+	// Applies cache quotas and anticipatory caching strategy from configuration
+	void configureCache(IConfiguration &conf,const SharedResources &shared=SharedResources());
+	// Cached content of files under pinned paths is never evicted
+	void setPinnedPaths(const std::vector<fs::path> &paths);
+	std::vector<fs::path> getPinnedPaths();
+	bool isPinnedPath(const fs::path &path);
+	ContentManager &getContentManager();
 
 protected:
 	virtual void cloudFetchMeta(Node &dest) =0;
@@ -124,6 +210,16 @@ protected:
 	virtual ContentManager::IReaderUPtr cloudReadMedia(Node &node) =0;
 	virtual void cloudUpdate(Node &node,int patchFields,const std::string &mediaType="",ContentManager::IReader *content=nullptr) =0;
 	virtual void cloudRemove(Node &node) =0;
+	// Copies file by server (dest has parent and name). Returns false if isn't supported
+	virtual bool cloudCopy(Node &source,Node &dest) { return false; }
+	// Nodes of 'other' can be copied by cloudCopy of this file system (drives of one account)
+	virtual bool isSameCloud(AbstractFileSystem &other) { return &other==this; }
+	// Lists all nodes of cloud (parentId of root's children is id of root). Returns false if isn't supported
+	virtual bool cloudFetchAll(Changes &all) { return false; }
+	// Returns changes since 'token' and moves it forward (empty token - only get the current one)
+	virtual bool cloudFetchChanges(std::string &token,Changes &changes) { return false; }
+	// Format which content of Exported node is read in (cached content of other format is stale)
+	virtual std::string cloudExportFormat(const Node &node) { return std::string(); }
 
 	void updateNodeContent(INode &n);
 	//Node *remove(const fs::path &path);
@@ -134,8 +230,58 @@ private:
 	class Notifier;
 	friend class Notifier;
 
+	void _updatePins(Node &n);
+	void _index(Node *n);
+	void _unindex(Node *n,bool recursive);
+	void _applyChange(Change &c);
+	void _notifyRemoved(Node &n,bool dropContent);
+	// Frees detached subtree, or keeps it in _removed while its files are open
+	void _dispose(Node *n);
+	// Called on close of handle, frees removed subtree after its last handle is closed
+	void _releaseHandle(Node *n);
+	static bool _isOpened(const Node &n);
+	// Copy of subtree of the same cloud (file content isn't transferred if cloud supports copying)
+	void _copy(Node &source,Node *destDir,const fs::path &newName);
+	void _copyNode(Node &source,Node *destDir,const fs::path &newName,WorkerPool &pool,std::exception_ptr &error);
+	void _attach(Node *dir,Node *n);
+	// Speculative filling of subdirectories (for eager prefetch strategy)
+	void _prefetchChildren(const std::string &dirId,size_t depth);
+	// Content of node found by open: cached, or being downloaded (task is set if download is started by the call)
+	struct ContentAccess
+	{
+		bool cached=false;
+		ContentDownloadPtr download;
+		std::function<void()> task;
+	};
+	// Joins running download of node's content, or checks cached one (stale is dropped), or starts download if 'start'.
+	// It's done under downloads mutex at once, so content being downloaded is never taken for stale one
+	ContentAccess _accessContent(Node &n,bool start);
+	// Starts download of node's content or joins running one (null if content is available at once).
+	// Not background download is executed by calling thread
+	ContentDownloadPtr _startDownload(Node &n,bool background);
+
 	sptr<Node> _root;
 	uptr<Cache> _cache;
 	uptr<Notifier> _notifier;
 	ContentManagerPtr _cm;
+	std::recursive_mutex _treeM;
+	std::mutex _pinnedM;
+	std::vector<fs::path> _pinned;
+	// Index of loaded nodes (guards by _treeM)
+	std::unordered_map<std::string,Node*> _byId;
+	std::string _rootId;
+	std::string _changeToken;
+	// Detached subtrees referenced by open handles yet
+	boost::ptr_vector<Node> _removed;
+	size_t _prefetchDepth=0;
+	size_t _prefetchBreadth=0;
+	size_t _copyThreads=1;
+	// Size reported for exported file before its first export
+	uint64_t _exportSizeEstimate=0;
+	std::mutex _downloadsM;
+	std::unordered_map<std::string,ContentDownloadPtr> _downloads;
+	// files are opened for reading while content is downloaded by the pool (null - open waits for whole content)
+	uptr<WorkerPool::Scope> _downloadPool;
+	// the last to stop tasks before tree destruction
+	uptr<WorkerPool::Scope> _prefetchPool;
 };
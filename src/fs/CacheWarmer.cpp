@@ -0,0 +1,205 @@
+#include "CacheWarmer.h"
+#include <fnmatch.h>
+#include <boost/format.hpp>
+
+namespace
+{
+	fs::path fixedPrefix(const std::string &glob)
+	{
+		fs::path ret;
+		for(const fs::path &part : fs::path(glob))
+		{
+			if(part.string().find_first_of("*?[")!=std::string::npos)
+				break;
+			ret/=part;
+		}
+		return ret;
+	}
+}
+
+CacheWarmer::CacheWarmer(AbstractFileSystem &fs,const WorkerPoolPtr &pool,size_t intervalSec)
+	: _fs(fs),
+	  _pool(pool)
+{
+	if(intervalSec)
+		_timer=std::thread(&CacheWarmer::_schedule,this,intervalSec);
+}
+
+CacheWarmer::~CacheWarmer()
+{
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		_stop=true;
+	}
+	_cv.notify_all();
+	if(_timer.joinable())
+		_timer.join();
+	// tasks refer to this
+	std::unique_lock<std::mutex> lock(_m);
+	_cv.wait(lock,[this]{ return !_tasks; });
+}
+
+void CacheWarmer::setGlobs(const std::vector<std::string> &globs)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	_globs=globs;
+}
+
+bool CacheWarmer::start()
+{
+	std::vector<std::string> globs;
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		if(_tasks || _stop)
+			return false;
+		globs=_globs;
+		_dirs=0;
+		_files=0;
+		_filesDone=0;
+		_bytes=0;
+		_errors=0;
+		// guard against finishing before all roots are posted
+		++_tasks;
+	}
+
+	for(const std::string &g : globs)
+	{
+		try
+		{
+			INode *n=_fs.get(fixedPrefix(g));
+			std::lock_guard<std::recursive_mutex> treeLock(_fs.getTreeMutex());
+			AbstractFileSystem::Node *root=dynamic_cast<AbstractFileSystem::Node*>(n);
+			if(root)
+				_post(root->getId(),root->isFolder());
+		}
+		catch(const G2FException&)
+		{
+			++_errors;
+		}
+	}
+	_taskDone();
+	return true;
+}
+
+bool CacheWarmer::isRunning()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _tasks!=0;
+}
+
+std::string CacheWarmer::getProgress()
+{
+	return (boost::format("%1% directories %2% files %3%/%4% downloaded %5% MB errors %6%")
+			% (isRunning() ? "running" : "idle")
+			% _dirs % _filesDone % _files % (_bytes/(1024*1024)) % _errors).str();
+}
+
+void CacheWarmer::_walk(const std::string &dirId)
+{
+	if(_isStopped())
+		return _taskDone();
+	try
+	{
+		bool filled=false;
+		{
+			std::lock_guard<std::recursive_mutex> treeLock(_fs.getTreeMutex());
+			AbstractFileSystem::Node *dir=_fs.findById(dirId);
+			if(!dir)
+				return _taskDone();
+			filled=dir->isFilled();
+		}
+		if(!filled && !_fs.fillDir(dirId))
+			return _taskDone();
+		++_dirs;
+
+		std::lock_guard<std::recursive_mutex> treeLock(_fs.getTreeMutex());
+		AbstractFileSystem::Node *dir=_fs.findById(dirId);
+		if(!dir)
+			return _taskDone();
+		for(AbstractFileSystem::Node &c : *dir)
+		{
+			if(_isStopped())
+				break;
+			if(c.isFolder() || _isMatched(c.getPath()))
+				_post(c.getId(),c.isFolder());
+		}
+	}
+	catch(const G2FException&)
+	{
+		++_errors;
+	}
+	_taskDone();
+}
+
+void CacheWarmer::_prefetch(const std::string &fileId)
+{
+	if(_isStopped())
+		return _taskDone();
+	try
+	{
+		// file removed since it was found isn't an error
+		uint64_t size=0;
+		if(_fs.prefetchContent(fileId,size))
+		{
+			++_filesDone;
+			_bytes+=size;
+		}
+	}
+	catch(const G2FException&)
+	{
+		++_errors;
+	}
+	_taskDone();
+}
+
+void CacheWarmer::_post(const std::string &id,bool isFolder)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	if(_stop)
+		return;
+	++_tasks;
+	if(isFolder)
+		_pool->post([this,id]{ _walk(id); });
+	else
+	{
+		++_files;
+		_pool->post([this,id]{ _prefetch(id); });
+	}
+}
+
+bool CacheWarmer::_isMatched(const fs::path &path)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	for(const std::string &g : _globs)
+	{
+		// glob of directory matches all its content
+		if(fnmatch(g.c_str(),path.c_str(),0)==0 || fnmatch((g+"/*").c_str(),path.c_str(),0)==0)
+			return true;
+	}
+	return false;
+}
+
+bool CacheWarmer::_isStopped()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _stop;
+}
+
+void CacheWarmer::_taskDone()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	if(!--_tasks)
+		_cv.notify_all();
+}
+
+void CacheWarmer::_schedule(size_t intervalSec)
+{
+	std::unique_lock<std::mutex> lock(_m);
+	while(!_stop)
+	{
+		lock.unlock();
+		start();
+		lock.lock();
+		_cv.wait_for(lock,std::chrono::seconds(intervalSec),[this]{ return _stop; });
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/decls.h"
+#include "utils/WorkerPool.h"
+#include "AbstractFileSystem.h"
+
+/**
+ * @brief Prefetches metadata and content of configured paths into cache
+ *
+ * Paths are set by globs ('*' matches '/' as well). Tree is walked from the
+ * longest wildcard-free prefix of each glob, directories and files are
+ * fetched by tasks of worker pool. Warming starts by request or periodically.
+ *
+ *********************************************************************/
+class CacheWarmer
+{
+public:
+	// interval==0 - warming starts only by request
+	CacheWarmer(AbstractFileSystem &fs,const WorkerPoolPtr &pool,size_t intervalSec=0);
+	~CacheWarmer();
+
+	void setGlobs(const std::vector<std::string> &globs);
+	// Returns false if warming is running already
+	bool start();
+	bool isRunning();
+	std::string getProgress();
+
+private:
+	// Tasks refer to nodes by id: node could be removed from tree before task runs
+	void _walk(const std::string &dirId);
+	void _prefetch(const std::string &fileId);
+	void _post(const std::string &id,bool isFolder);
+	bool _isMatched(const fs::path &path);
+	bool _isStopped();
+	void _taskDone();
+	void _schedule(size_t intervalSec);
+
+	AbstractFileSystem &_fs;
+	WorkerPoolPtr _pool;
+
+	std::mutex _m;
+	std::condition_variable _cv;
+	std::vector<std::string> _globs;
+	size_t _tasks=0;
+	bool _stop=false;
+	std::thread _timer;
+
+	std::atomic<size_t> _dirs{0};
+	std::atomic<size_t> _files{0};
+	std::atomic<size_t> _filesDone{0};
+	std::atomic<uint64_t> _bytes{0};
+	std::atomic<size_t> _errors{0};
+};
+G2F_DECLARE_PTR(CacheWarmer);
@@ -0,0 +1,50 @@
+#include "ChangeSync.h"
+#include "error/G2FException.h"
+
+ChangeSync::ChangeSync(AbstractFileSystem &fs,size_t intervalSec)
+	: _fs(fs)
+{
+	if(intervalSec)
+		_poller=std::thread(&ChangeSync::_poll,this,intervalSec);
+}
+
+ChangeSync::~ChangeSync()
+{
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		_stop=true;
+	}
+	_cv.notify_all();
+	if(_poller.joinable())
+		_poller.join();
+}
+
+size_t ChangeSync::getErrors()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _errors;
+}
+
+void ChangeSync::_poll(size_t intervalSec)
+{
+	// if tree isn't bootstrapped the first call only remembers position in change feed
+	std::unique_lock<std::mutex> lock(_m);
+	do
+	{
+		lock.unlock();
+		bool failed=false;
+		try
+		{
+			_fs.syncChanges();
+		}
+		catch(const std::exception&)
+		{
+			// will be retried by the next poll
+			failed=true;
+		}
+		lock.lock();
+		if(failed)
+			++_errors;
+	}
+	while(!_cv.wait_for(lock,std::chrono::seconds(intervalSec),[this]{ return _stop; }));
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "utils/decls.h"
+#include "AbstractFileSystem.h"
+
+/**
+ * @brief Periodically applies changes made in cloud to loaded tree
+ *
+ * Changes are polled from change feed of the cloud, so remote renames,
+ * removals and updates become visible without re-listing directories.
+ *
+ *********************************************************************/
+class ChangeSync
+{
+public:
+	ChangeSync(AbstractFileSystem &fs,size_t intervalSec);
+	~ChangeSync();
+
+	size_t getErrors();
+
+private:
+	void _poll(size_t intervalSec);
+
+	AbstractFileSystem &_fs;
+
+	std::mutex _m;
+	std::condition_variable _cv;
+	bool _stop=false;
+	size_t _errors=0;
+	std::thread _poller;
+};
+G2F_DECLARE_PTR(ChangeSync);
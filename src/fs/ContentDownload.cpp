@@ -0,0 +1,41 @@
+#include "ContentDownload.h"
+
+ContentDownload::ContentDownload(uint64_t size)
+	: _size(size)
+{}
+
+void ContentDownload::advance(uint64_t frontier)
+{
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		_frontier=frontier;
+	}
+	_cv.notify_all();
+}
+
+void ContentDownload::finish(posix_error_code error)
+{
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		_error=error;
+		_done=true;
+	}
+	_cv.notify_all();
+}
+
+posix_error_code ContentDownload::waitFor(uint64_t end)
+{
+	// reading beyond known size (or of unknown size) waits for the end of download
+	if(!_size || end>_size)
+		return wait();
+	std::unique_lock<std::mutex> lock(_m);
+	_cv.wait(lock,[this,end]{return _done || _frontier>=end;});
+	return _frontier>=end ? 0 : _error;
+}
+
+posix_error_code ContentDownload::wait()
+{
+	std::unique_lock<std::mutex> lock(_m);
+	_cv.wait(lock,[this]{return _done;});
+	return _error;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include "utils/decls.h"
+
+/**
+ * @brief Progress of content being downloaded into cache
+ *
+ * Content is written sequentially, so downloaded part is [0,frontier).
+ * Readers of open file wait until the range they need is below frontier
+ * instead of waiting for the whole file.
+ *
+ *********************************************************************/
+class ContentDownload
+{
+public:
+	ContentDownload(uint64_t size);
+
+	// Called by downloading thread
+	void advance(uint64_t frontier);
+	void finish(posix_error_code error);
+
+	// Blocks until [0,end) is downloaded or download is finished. Returns error of download
+	posix_error_code waitFor(uint64_t end);
+	// Blocks until download is finished
+	posix_error_code wait();
+
+private:
+	std::mutex _m;
+	std::condition_variable _cv;
+	uint64_t _size;
+	uint64_t _frontier=0;
+	bool _done=false;
+	posix_error_code _error=0;
+};
+G2F_DECLARE_PTR(ContentDownload);
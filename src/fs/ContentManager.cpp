@@ -1,10 +1,18 @@
 #include "ContentManager.h"
 #include "error/G2FException.h"
+#include "utils/AlignedBuffer.h"
+#include <boost/algorithm/hex.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <cstdio>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <thread>
 
 namespace
 {
@@ -25,6 +33,33 @@ namespace
 			ret=id;
 		return ret;
 	}
+
+	// Drive's ids never start with dot
+	const fs::path OBJECTS_DIR(".objects");
+
+	fs::path versionFileName(const fs::path &fileName)
+	{
+		fs::path ret=fileName;
+		ret+=".ver";
+		return ret;
+	}
+
+	fs::path pinFileName(const fs::path &fileName)
+	{
+		fs::path ret=fileName;
+		ret+=".pin";
+		return ret;
+	}
+
+	fs::path partFileName(const fs::path &fileName)
+	{
+		fs::path ret=fileName;
+		ret+=".part";
+		return ret;
+	}
+
+	// Eviction frees cache up to this part of limits, so it doesn't run on every open
+	const double EVICTION_LOW_WATERMARK=0.9;
 }
 
 
@@ -53,9 +88,479 @@ private:
 };
 
 
+
+/**
+ * @brief Writes file by separate thread while caller fills next buffers
+ *
+ * Caller acquires free buffer, fills it and submits. Writer thread stores
+ * submitted buffers in order and returns them to free list. When all
+ * buffers are in flight acquire() blocks, so slow disk holds back reader.
+ * After error of writing buffers are discarded to don't stall caller.
+ *
+ *****************************************************/
+class PipelinedWriter
+{
+public:
+	PipelinedWriter(int fd,int flags,const ContentManager::Progress &progress,size_t buffers=4)
+		: _fd(fd),
+		  _flags(flags),
+		  _progress(progress)
+	{
+		for(size_t i=0;i<buffers;i++)
+		{
+			_buffers.push_back(std::make_unique<AlignedBuffer>());
+			_free.push_back(_buffers.back().get());
+		}
+		_thread=std::thread(&PipelinedWriter::_run,this);
+	}
+	~PipelinedWriter()
+	{
+		finish();
+	}
+
+	// nullptr if writing failed
+	AlignedBuffer *acquire()
+	{
+		std::unique_lock<std::mutex> lock(_m);
+		_cv.wait(lock,[this]{return !_free.empty() || _err;});
+		if(_err)
+			return nullptr;
+		AlignedBuffer *ret=_free.front();
+		_free.pop_front();
+		return ret;
+	}
+
+	void submit(AlignedBuffer *buf,size_t filled)
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		_filled.emplace_back(buf,filled);
+		_cv.notify_all();
+	}
+
+	// waits for all submitted buffers, returns errno of writing
+	int finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_m);
+			_done=true;
+			_cv.notify_all();
+		}
+		if(_thread.joinable())
+			_thread.join();
+		return _err;
+	}
+
+	uint64_t written() const
+	{
+		return _offset;
+	}
+
+private:
+	void _run()
+	{
+		std::unique_lock<std::mutex> lock(_m);
+		while(true)
+		{
+			_cv.wait(lock,[this]{return !_filled.empty() || _done;});
+			if(_filled.empty())
+				break;
+			AlignedBuffer *buf=_filled.front().first;
+			size_t filled=_filled.front().second;
+			_filled.pop_front();
+			if(!_err)
+			{
+				lock.unlock();
+				int err=_write(buf->data(),filled);
+				if(!err && _progress)
+					_progress(_offset);
+				lock.lock();
+				_err=err;
+			}
+			_free.push_back(buf);
+			_cv.notify_all();
+		}
+	}
+
+	int _write(const char *data,size_t size)
+	{
+		// O_DIRECT requires aligned size, the tail of file is written through page cache
+		if((_flags&O_DIRECT) && size%AlignedBuffer::ALIGNMENT)
+		{
+			_flags&=~O_DIRECT;
+			fcntl(_fd,F_SETFL,_flags);
+		}
+		for(size_t written=0;written<size;)
+		{
+			ssize_t ret=pwrite(_fd,data+written,size-written,_offset+written);
+			if(ret<0 && errno==EINTR)
+				continue;
+			if(ret<0)
+				return errno;
+			written+=ret;
+		}
+		_offset+=size;
+		return 0;
+	}
+
+	int _fd;
+	int _flags;
+	ContentManager::Progress _progress;
+	std::vector<uptr<AlignedBuffer>> _buffers;
+	std::deque<AlignedBuffer*> _free;
+	std::deque<std::pair<AlignedBuffer*,size_t>> _filled;
+	std::mutex _m;
+	std::condition_variable _cv;
+	std::thread _thread;
+	std::atomic<uint64_t> _offset{0};
+	int _err=0;
+	bool _done=false;
+};
+
+
+const uint64_t ContentManager::UNKNOWN_SIZE;
+
 ContentManager::ContentManager(const boost::filesystem::path &workDir)
 	: _workDir(workDir)
-{}
+{
+	collectGarbage();
+	_scan();
+}
+
+ContentManager::~ContentManager()
+{
+	if(_budget)
+		_budget->bytes-=_bytes;
+}
+
+void ContentManager::setLimits(const Limits &limits)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	_limits=limits;
+	_evict();
+}
+
+ContentManager::Limits ContentManager::getLimits()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _limits;
+}
+
+void ContentManager::setIOOptions(const IOOptions &opts)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	_io=opts;
+}
+
+void ContentManager::setBudget(const BudgetPtr &budget)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	if(_budget)
+		_budget->bytes-=_bytes;
+	_budget=budget;
+	if(_budget)
+		_budget->bytes+=_bytes;
+	_evict();
+}
+
+void ContentManager::setPinned(const std::string &id, bool pinned)
+{
+	fs::path fileName=_workDir/id2fileName(id);
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_entries.find(id);
+	if(it==_entries.end() || it->second.pinned==pinned)
+		return;
+	it->second.pinned=pinned;
+	if(pinned)
+	{
+		fs::ofstream marker(pinFileName(fileName));
+	}
+	else
+	{
+		boost::system::error_code ec;
+		fs::remove(pinFileName(fileName),ec);
+		_evict();
+	}
+}
+
+void ContentManager::beginDownload(const std::string &id)
+{
+	fs::path fileName=_workDir/id2fileName(id);
+	boost::system::error_code ec;
+	fs::create_directories(fileName.parent_path(),ec);
+	std::lock_guard<std::mutex> lock(_m);
+	if(_entry(id).downloads++==0)
+		fs::ofstream marker(partFileName(fileName));
+}
+
+void ContentManager::endDownload(const std::string &id)
+{
+	fs::path fileName=_workDir/id2fileName(id);
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_entries.find(id);
+	if(it!=_entries.end() && it->second.downloads && --it->second.downloads)
+		return;
+	boost::system::error_code ec;
+	fs::remove(partFileName(fileName),ec);
+	_evict();
+}
+
+uint64_t ContentManager::getCachedBytes()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _bytes;
+}
+
+size_t ContentManager::getCachedFiles()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _entries.size();
+}
+
+uint64_t ContentManager::getCachedSize(const std::string &id)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_entries.find(id);
+	return it!=_entries.end() ? it->second.size : 0;
+}
+
+void ContentManager::_scan()
+{
+	// Files aren't removed while directory is iterated
+	std::vector<fs::path> interrupted;
+	boost::system::error_code ec;
+	for(fs::recursive_directory_iterator it(_workDir,ec),itEnd;!ec && it!=itEnd;it.increment(ec))
+	{
+		const fs::path &p=it->path();
+		if(it.level()==0 && p.filename()==OBJECTS_DIR)
+		{
+			it.no_push();
+			continue;
+		}
+		if(p.has_extension() || !fs::is_regular_file(it->status()))
+			continue;
+
+		std::string id;
+		for(const auto &part : p.lexically_relative(_workDir))
+			id+=part.string();
+
+		// Download was interrupted, partial content mustn't be taken for changed one
+		if(fs::exists(partFileName(p),ec))
+		{
+			interrupted.push_back(p);
+			continue;
+		}
+
+		struct stat st,stVer;
+		if(stat(p.c_str(),&st)!=0)
+			continue;
+		Entry &e=_entry(id);
+		_setSize(e,st.st_size);
+		e.lastAccess=st.st_atime;
+		// Content is changed after last sync with cloud. Content without version (e.g. cached
+		// before versions were recorded) isn't taken for changed, it's revalidated on open
+		e.dirty=stat(versionFileName(p).c_str(),&stVer)==0 &&
+				std::tie(st.st_mtim.tv_sec,st.st_mtim.tv_nsec)>std::tie(stVer.st_mtim.tv_sec,stVer.st_mtim.tv_nsec);
+		e.pinned=fs::exists(pinFileName(p),ec);
+	}
+	for(const fs::path &p : interrupted)
+	{
+		fs::remove(p,ec);
+		fs::remove(versionFileName(p),ec);
+		fs::remove(pinFileName(p),ec);
+		fs::remove(partFileName(p),ec);
+	}
+}
+
+ContentManager::Entry &ContentManager::_entry(const std::string &id)
+{
+	return _entries[id];
+}
+
+void ContentManager::_setSize(Entry &e, uint64_t size)
+{
+	_bytes=_bytes-e.size+size;
+	if(_budget)
+		_budget->bytes+=size-e.size;
+	e.size=size;
+}
+
+void ContentManager::_evict()
+{
+	auto over=[this](double part)
+	{
+		return (_limits.maxBytes && _limitedBytes()>_limits.maxBytes*part) ||
+				(_limits.maxFiles && _entries.size()>_limits.maxFiles*part);
+	};
+	if(!over(1.0))
+		return;
+
+	std::vector<Entries::const_iterator> victims;
+	for(auto it=_entries.cbegin();it!=_entries.cend();++it)
+	{
+		const Entry &e=it->second;
+		if(!e.opened && !e.downloads && !e.dirty && !e.pinned)
+			victims.push_back(it);
+	}
+	if(_limits.policy==EvictionPolicy::LFU)
+		std::sort(victims.begin(),victims.end(),[](const auto &a,const auto &b)
+		{
+			return std::tie(a->second.hits,a->second.lastAccess)<std::tie(b->second.hits,b->second.lastAccess);
+		});
+	else
+		std::sort(victims.begin(),victims.end(),[](const auto &a,const auto &b)
+		{
+			return a->second.lastAccess<b->second.lastAccess;
+		});
+
+	for(auto it : victims)
+	{
+		if(!over(EVICTION_LOW_WATERMARK))
+			break;
+		try
+		{
+			_deleteFile(std::string(it->first));
+		}
+		catch(const G2FException&)
+		{}
+	}
+}
+
+uint64_t ContentManager::_limitedBytes() const
+{
+	return _budget ? _budget->bytes.load() : _bytes;
+}
+
+bool ContentManager::Version::isKnown() const
+{
+	return isValidMD5(md5) || modified.tv_sec!=0 || modified.tv_nsec!=0 || !etag.empty();
+}
+
+bool ContentManager::Version::isSame(const Version &other) const
+{
+	if(format!=other.format)
+		return false;
+	if(isValidMD5(md5) || isValidMD5(other.md5))
+		return md5==other.md5;
+	if(modified.tv_sec!=0 || other.modified.tv_sec!=0)
+		return modified.tv_sec==other.modified.tv_sec && modified.tv_nsec==other.modified.tv_nsec;
+	return etag==other.etag;
+}
+
+bool ContentManager::isValidMD5(const MD5Signature &md5)
+{
+	return std::any_of(md5.begin(),md5.end(),[](int8_t b){ return b!=0; });
+}
+
+bool ContentManager::shareContent(const std::string &id, const MD5Signature &md5)
+{
+	if(!isValidMD5(md5))
+		return false;
+	fs::path blobName=_blobFileName(md5);
+	fs::path fileName=_workDir/id2fileName(id);
+
+	boost::system::error_code ec;
+	if(!fs::exists(blobName,ec))
+		return false;
+	fs::create_directories(fileName.parent_path(),ec);
+	fs::create_hard_link(blobName,fileName,ec);
+	if(ec)
+		return false;
+
+	// Size of shared content is accounted for every id (upper estimation)
+	uint64_t size=fs::file_size(fileName,ec);
+	std::lock_guard<std::mutex> lock(_m);
+	Entry &e=_entry(id);
+	_setSize(e,ec ? 0 : size);
+	e.lastAccess=time(nullptr);
+	return true;
+}
+
+void ContentManager::storeContent(const std::string &id, const MD5Signature &md5)
+{
+	if(!isValidMD5(md5))
+		return;
+	fs::path blobName=_blobFileName(md5);
+	fs::path fileName=_workDir/id2fileName(id);
+
+	// Open writers would change content of blob shared by other ids. Writer registered later
+	// detaches linked content on open, so the check and linking are done under the lock
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_entries.find(id);
+	if(it!=_entries.end() && it->second.writers)
+		return;
+
+	// Sharing is optimization only, so errors are ignored
+	boost::system::error_code ec;
+	if(fs::exists(blobName,ec))
+	{
+		if(fs::equivalent(blobName,fileName,ec))
+			return;
+		// same content is stored already - replace copy by link
+		fs::path tmpName=fileName;
+		tmpName+=".lnk";
+		fs::create_hard_link(blobName,tmpName,ec);
+		if(!ec)
+			fs::rename(tmpName,fileName,ec);
+		if(ec)
+			fs::remove(tmpName,ec);
+	}
+	else
+	{
+		fs::create_directories(blobName.parent_path(),ec);
+		fs::create_hard_link(fileName,blobName,ec);
+	}
+}
+
+void ContentManager::collectGarbage()
+{
+	boost::system::error_code ec;
+	for(fs::recursive_directory_iterator it(_workDir/OBJECTS_DIR,ec),itEnd;!ec && it!=itEnd;it.increment(ec))
+	{
+		if(fs::is_regular_file(it->status()) && fs::hard_link_count(it->path(),ec)==1)
+			fs::remove(it->path(),ec);
+	}
+}
+
+fs::path ContentManager::_blobFileName(const MD5Signature &md5) const
+{
+	std::string hex;
+	boost::algorithm::hex(md5.begin(),md5.end(),std::back_inserter(hex));
+	return _workDir/OBJECTS_DIR/hex.substr(0,2)/hex.substr(2);
+}
+
+void ContentManager::_detach(const fs::path &fileName)
+{
+	// Copy-on-write: content shared by hard link mustn't be changed in place
+	G2FError ec;
+	uintmax_t links=fs::hard_link_count(fileName,ec);
+	if(ec || links<=1)
+		return;
+	fs::path tmpName=fileName;
+	tmpName+=".cow";
+	fs::copy_file(fileName,tmpName,fs::copy_option::overwrite_if_exists,ec);
+	if(!ec)
+		fs::rename(tmpName,fileName,ec);
+	if(ec)
+	{
+		boost::system::error_code ignored;
+		fs::remove(tmpName,ignored);
+		G2FExceptionBuilder("Media manager: can not detach shared content of file '%1'").arg(fileName).throwIt(ec);
+	}
+	// The file could be the last reference to blob besides the blob itself
+	Version v;
+	if(_readVersion(fileName,v))
+		_releaseBlob(v.md5);
+}
+
+void ContentManager::_releaseBlob(const MD5Signature &md5)
+{
+	if(!isValidMD5(md5))
+		return;
+	fs::path blobName=_blobFileName(md5);
+	boost::system::error_code ec;
+	if(fs::hard_link_count(blobName,ec)==1)
+		fs::remove(blobName,ec);
+}
 
 bool ContentManager::is(const std::string &id)
 {
@@ -63,24 +568,138 @@ bool ContentManager::is(const std::string &id)
 	return fs::exists(fileName);
 }
 
+bool ContentManager::isDirty(const std::string &id)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_entries.find(id);
+	return it!=_entries.end() && it->second.dirty;
+}
+
+bool ContentManager::isActual(const std::string &id, const Version &v)
+{
+	// Content hasn't been uploaded ever
+	if(!v.isKnown())
+		return true;
+	Version cached;
+	if(!_readVersion(_workDir/id2fileName(id),cached))
+		return false;
+	return cached.isSame(v);
+}
+
+void ContentManager::setVersion(const std::string &id, const Version &v)
+{
+	fs::path fileName=versionFileName(_workDir/id2fileName(id));
+	std::string hex;
+	boost::algorithm::hex(v.md5.begin(),v.md5.end(),std::back_inserter(hex));
+
+	fs::ofstream out(fileName,std::ios::trunc);
+	out << hex << '\n' << v.modified.tv_sec << ' ' << v.modified.tv_nsec << '\n' << v.etag << '\n' << v.format << '\n';
+	if(!out)
+		G2FExceptionBuilder("Media manager: can not write version of file '%1'").arg(fileName).throwItSystem(EIO);
+
+	// content is synchronized with cloud
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_entries.find(id);
+	if(it!=_entries.end())
+		it->second.dirty=false;
+}
+
+bool ContentManager::_readVersion(const fs::path &fileName, ContentManager::Version &v)
+{
+	fs::ifstream in(versionFileName(fileName));
+	std::string hex;
+	if(!(in >> hex >> v.modified.tv_sec >> v.modified.tv_nsec))
+		return false;
+	// etag and format could be empty (format is absent in files of previous versions)
+	in.ignore(std::numeric_limits<std::streamsize>::max(),'\n');
+	std::getline(in,v.etag);
+	std::getline(in,v.format);
+	try
+	{
+		if(hex.size()!=v.md5.size()*2)
+			return false;
+		boost::algorithm::unhex(hex,v.md5.begin());
+	}
+	catch(const boost::algorithm::hex_decode_error&)
+	{
+		return false;
+	}
+	return true;
+}
+
 int64_t ContentManager::openFile(const std::string &id,int flags)
 {
 	fs::path fileName=_workDir/id2fileName(id);
 	//if(!(flags&O_CREAT) && !fs::exists(fileName))
 	//	G2FExceptionBuilder("Media manager: attempt to open non existent file '%1'").arg(fileName).throwItSystem(ENOENT);
+	const bool writable=(flags&O_ACCMODE)!=O_RDONLY;
+	// Writer is counted before detaching, so content can't be linked into blob after that
+	if(writable)
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		++_entry(id).writers;
+	}
+	int fileDesc=-1;
+	try
+	{
+		if(writable || (flags&O_TRUNC))
+			_detach(fileName);
 
-	int fileDesc=open(fileName.c_str(),flags,S_IRUSR|S_IWUSR);
-	if(fileDesc==-1)
+		fileDesc=open(fileName.c_str(),flags,S_IRUSR|S_IWUSR);
+		if(fileDesc==-1)
+		{
+			int err=errno;
+			G2FExceptionBuilder("Media manager: can not open file '%1'").arg(fileName).throwItSystem(err);
+		}
+	}
+	catch(...)
 	{
-		int err=errno;
-		G2FExceptionBuilder("Media manager: can not open file '%1'").arg(fileName).throwItSystem(err);
+		if(writable)
+		{
+			std::lock_guard<std::mutex> lock(_m);
+			--_entry(id).writers;
+		}
+		throw;
 	}
+
+	struct stat st;
+	std::lock_guard<std::mutex> lock(_m);
+	Entry &e=_entry(id);
+	if(fstat(fileDesc,&st)==0)
+		_setSize(e,st.st_size);
+	++e.opened;
+	++e.hits;
+	e.lastAccess=time(nullptr);
+	// Opening for writing doesn't change content, truncation does
+	if((flags&O_TRUNC) && writable)
+		e.dirty=true;
+	OpenedFile &f=_fds[fileDesc];
+	f.id=id;
+	f.writable=writable;
+	_evict();
 	return fileDesc;
 }
 
 void ContentManager::closeFile(int64_t fd)
 {
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_fds.find(fd);
+	if(it!=_fds.end())
+	{
+		auto itEntry=_entries.find(it->second.id);
+		if(itEntry!=_entries.end())
+		{
+			struct stat st;
+			if(fstat(fd,&st)==0)
+				_setSize(itEntry->second,st.st_size);
+			--itEntry->second.opened;
+			if(it->second.writable)
+				--itEntry->second.writers;
+		}
+		_fds.erase(it);
+	}
 	close(fd);
+	_evict();
 }
 
 int ContentManager::readContent(int64_t fd, char *buf, size_t len, off_t offset)
@@ -111,30 +730,64 @@ int ContentManager::writeContent(int64_t fd, const char *buf, size_t len, off_t
 		int err=errno;
 		G2FExceptionBuilder("Media manager: error writing content to open file").throwItSystem(err);
 	}
+	if(ret>0)
+		_markWritten(fd);
 	return ret;
 }
 
+void ContentManager::_markWritten(int64_t fd)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	auto it=_fds.find(fd);
+	if(it==_fds.end())
+		return;
+	auto itEntry=_entries.find(it->second.id);
+	if(itEntry!=_entries.end())
+		itEntry->second.dirty=true;
+}
+
 void ContentManager::truncateFile(const std::string &id, size_t size, off_t newSize)
 {
 	fs::path fileName=_workDir/id2fileName(id);
 
 	if(!fs::exists(fileName))
 		G2FExceptionBuilder("Media manager: attempt to open non existent file '%1'").arg(fileName).throwItSystem(ENOENT);
+	_detach(fileName);
 
 	if(truncate(fileName.c_str(),newSize)<0)
 	{
 		int err=errno;
 		G2FExceptionBuilder("Media manager: error truncate file '%1'").arg(fileName).throwItSystem(err);
 	}
+
+	std::lock_guard<std::mutex> lock(_m);
+	Entry &e=_entry(id);
+	_setSize(e,newSize);
+	e.dirty=true;
 }
 
-void ContentManager::createFile(const std::string &id,IReader* content)
+uint64_t ContentManager::createFile(const std::string &id,IReader* content,uint64_t size,const Progress &progress)
 {
 	fs::path fileName=_workDir/id2fileName(id);
 	if(!fs::exists(fileName.parent_path()))
 		fs::create_directories(fileName.parent_path());
+	_detach(fileName);
 
-	AutocloseableHandler fd=creat(fileName.c_str(),S_IRUSR|S_IWUSR);
+	IOOptions io;
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		io=_io;
+	}
+	int flags=O_WRONLY|O_CREAT|O_TRUNC;
+	if(io.directIO && content)
+		flags|=O_DIRECT;
+	AutocloseableHandler fd=open(fileName.c_str(),flags,S_IRUSR|S_IWUSR);
+	// some file systems (e.g. tmpfs) don't support O_DIRECT
+	if(fd<0 && (flags&O_DIRECT) && errno==EINVAL)
+	{
+		flags&=~O_DIRECT;
+		fd=open(fileName.c_str(),flags,S_IRUSR|S_IWUSR);
+	}
 	if(fd<0)
 	{
 		int err=errno;
@@ -142,34 +795,87 @@ void ContentManager::createFile(const std::string &id,IReader* content)
 	}
 	if(content)
 	{
-		char buf[4096];
+		if(io.preallocate && size!=UNKNOWN_SIZE && size)
+			posix_fallocate(fd,0,size);
 
-		while(!content->done())
+		// Reader's chunks are gathered into large buffers, so file is written by few big writes.
+		// Network reading and disk writing overlap
+		PipelinedWriter writer(fd,flags,progress);
+		bool more=true;
+		while(more && !content->done())
 		{
-			int64_t readed=content->read(buf,sizeof(buf));
-			int written=write(fd,buf,readed);
-			if(written<0)
+			AlignedBuffer *buf=writer.acquire();
+			if(!buf)
+				break;
+			size_t filled=0;
+			while(filled<buf->size() && !content->done())
 			{
-				int err=errno;
-				G2FExceptionBuilder("Media manager: Error writing content into file '%1'").arg(fileName).throwItSystem(err);
+				int64_t readed=content->read(buf->data()+filled,buf->size()-filled);
+				if(readed<=0)
+				{
+					// error or end of stream (checked below)
+					more=false;
+					break;
+				}
+				filled+=readed;
 			}
+			writer.submit(buf,filled);
 		}
+		if(int err=writer.finish())
+			G2FExceptionBuilder("Media manager: Error writing content into file '%1'").arg(fileName).throwItSystem(err);
+		uint64_t total=writer.written();
 		G2FError e=content->error();
 		if(e!=err::errc::success)
 			G2FExceptionBuilder("Media manager: Error writing content into file '%1'").arg(fileName).throwIt(e);
+		// truncated content mustn't be taken for complete one
+		if(!content->done())
+			G2FExceptionBuilder("Media manager: Content of file '%1' ended after %2 bytes").arg(fileName).arg(total).throwItSystem(EIO);
+		// preallocated tail of shorter content is cut
+		if(size!=UNKNOWN_SIZE && total<size && ftruncate(fd,total)<0)
+		{
+			int err=errno;
+			G2FExceptionBuilder("Media manager: error truncate file '%1'").arg(fileName).throwItSystem(err);
+		}
 	}
+
+	struct stat st;
+	std::lock_guard<std::mutex> lock(_m);
+	Entry &e=_entry(id);
+	_setSize(e,fstat(fd,&st)==0 ? st.st_size : 0);
+	e.lastAccess=time(nullptr);
+	return e.size;
 }
 
 bool ContentManager::deleteFile(const std::string &id)
 {
+	std::lock_guard<std::mutex> lock(_m);
+	return _deleteFile(id);
+}
+
+bool ContentManager::_deleteFile(const std::string &id)
+{
+	auto it=_entries.find(id);
+	if(it!=_entries.end())
+	{
+		_setSize(it->second,0);
+		_entries.erase(it);
+	}
+
 	fs::path fileName=_workDir/id2fileName(id);
 
 	if(fs::exists(fileName))
 	{
+		Version v;
+		bool hasVersion=_readVersion(fileName,v);
 		G2FError e;
 		fs::remove(fileName,e);
 		if(e!=err::errc::success)
 			G2FExceptionBuilder("Media manager: Error of deleting file '%1'").arg(fileName).throwIt(e);
+		fs::remove(versionFileName(fileName),e);
+		fs::remove(pinFileName(fileName),e);
+		fs::remove(partFileName(fileName),e);
+		if(hasVersion)
+			_releaseBlob(v.md5);
 		return true;
 	}
 	return false;
@@ -179,30 +885,51 @@ bool ContentManager::deleteFile(const std::string &id)
 class ContentReader : public ContentManager::IReader
 {
 public:
-	typedef std::unique_ptr<FILE,decltype(&fclose)> AutoFileHandle;
-
-	ContentReader(AutoFileHandle &&fh)
-		: _fh(std::move(fh))
-	{}
+	ContentReader(int fd)
+		: _fd(fd)
+	{
+		posix_fadvise(fd,0,0,POSIX_FADV_SEQUENTIAL);
+	}
+	~ContentReader()
+	{
+		close(_fd);
+	}
 	// IReader interface
 public:
 	virtual bool done() override
 	{
-		return feof(_fh.get())!=0;
+		return _eof || _err;
 	}
 	virtual int64_t read(char *buffer, int64_t bufSize) override
 	{
-		int ret=fread(buffer,1,bufSize,_fh.get());
-		_err=errno;
+		// consumer gets data by large chunks, so buffering of stdio is useless
+		ssize_t ret;
+		do
+			ret=::read(_fd,buffer,bufSize);
+		while(ret<0 && errno==EINTR);
+		if(ret<0)
+		{
+			_err=errno;
+			return -1;
+		}
+		if(ret==0)
+			_eof=true;
 		return ret;
 	}
 	virtual G2FError error() override
 	{
-		return G2FError(0,err::generic_category());
+		return G2FError(_err,err::generic_category());
+	}
+	virtual bool rewind() override
+	{
+		_eof=false;
+		_err=0;
+		return lseek(_fd,0,SEEK_SET)==0;
 	}
 
 private:
-	AutoFileHandle _fh;
+	int _fd=-1;
+	bool _eof=false;
 	int _err=0;
 };
 
@@ -212,13 +939,13 @@ ContentManager::IReaderPtr ContentManager::readContent(const std::string &id)
 	if(!fs::exists(fileName))
 		G2FExceptionBuilder("Media manager: attempt to read content of non existent file '%1'").arg(fileName).throwItSystem(ENOENT);
 
-	ContentReader::AutoFileHandle f(fopen(fileName.c_str(),"r"),fclose);
-	if(!f)
+	int fd=open(fileName.c_str(),O_RDONLY);
+	if(fd<0)
 	{
 		int err=errno;
 		G2FExceptionBuilder("Media manager: can not open file '%1' for reading").arg(fileName).throwItSystem(err);
 	}
-	return std::make_shared<ContentReader>(std::move(f));
+	return std::make_shared<ContentReader>(fd);
 }
 
 /*
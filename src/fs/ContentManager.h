@@ -2,6 +2,12 @@
 
 #include "utils/decls.h"
 #include "error/appError.h"
+#include "utils/assets.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 
 class ContentManager
 {
@@ -12,27 +18,153 @@ public:
 		virtual bool done() =0;
 		virtual int64_t read(char* buffer, int64_t bufSize) =0;
 		virtual G2FError error() =0;
+		// Restarts reading from the beginning (if supported)
+		virtual bool rewind() { return false; }
 
 		virtual ~IReader() {}
 	};
 	G2F_DECLARE_PTR(IReader);
+	// Receives size of content already written into file
+	typedef std::function<void(uint64_t)> Progress;
+	// Size of content that is known after reading only (e.g. export of document)
+	static const uint64_t UNKNOWN_SIZE=UINT64_MAX;
+
+	/**
+	 * @brief Remote state of content is kept in cache
+	 *
+	 * Cached content is actual while remote md5 (or modification time for
+	 * files without md5, or etag when nothing else is known) is same.
+	 * Exported content is also bound to format it's exported in
+	 */
+	struct Version
+	{
+		MD5Signature md5{};
+		std::string etag;
+		timespec modified={0,0};
+		std::string format;
+
+		bool isKnown() const;
+		bool isSame(const Version &other) const;
+	};
+
+	enum class EvictionPolicy
+	{
+		LRU,
+		LFU
+	};
+
+	// Quotas of cache (0 - unlimited)
+	struct Limits
+	{
+		uint64_t maxBytes=0;
+		size_t maxFiles=0;
+		EvictionPolicy policy=EvictionPolicy::LRU;
+	};
+
+	// Size of content cached by several managers (e.g. of different accounts) limited together
+	struct Budget
+	{
+		std::atomic<uint64_t> bytes{0};
+	};
+	typedef sptr<Budget> BudgetPtr;
+
+	// Writing of downloaded content into cache files
+	struct IOOptions
+	{
+		// bypass page cache (content isn't read back right after download)
+		bool directIO=false;
+		// reserve space of file at once to avoid fragmentation
+		bool preallocate=true;
+	};
 
 	ContentManager(const fs::path &workDir);
+	~ContentManager();
+
+	// Files over limits are evicted unless they are open, pinned or have changes not uploaded yet
+	void setLimits(const Limits &limits);
+	Limits getLimits();
+	void setIOOptions(const IOOptions &opts);
+	// maxBytes of limits is applied to the whole budget. Files of this manager only are evicted
+	void setBudget(const BudgetPtr &budget);
+	void setPinned(const std::string &id,bool pinned);
+	// File of id is being filled by download: it isn't evicted, and it's dropped at startup if the download was interrupted
+	void beginDownload(const std::string &id);
+	void endDownload(const std::string &id);
+	uint64_t getCachedBytes();
+	size_t getCachedFiles();
+	// Size of cached content of id (0 if it isn't cached)
+	uint64_t getCachedSize(const std::string &id);
+
+	// Content is stored once per MD5 (hard links from id files to shared blob)
+	static bool isValidMD5(const MD5Signature &md5);
+	// Attaches already stored content with same md5 to id (without transfer)
+	bool shareContent(const std::string &id,const MD5Signature &md5);
+	// Makes content of id available for sharing by md5
+	void storeContent(const std::string &id,const MD5Signature &md5);
+	// Removes blobs referenced by nobody
+	void collectGarbage();
 
 	bool is(const std::string &id);
+	// Cached content of id has changes not uploaded yet
+	bool isDirty(const std::string &id);
+	// Does cached content of id correspond to remote version 'v'
+	bool isActual(const std::string &id,const Version &v);
+	void setVersion(const std::string &id,const Version &v);
 	int64_t openFile(const std::string &id, int flags);
 	void closeFile(int64_t fd);
 	int readContent(int64_t fd,char *buf, size_t len, off_t offset);
 	int writeContent(int64_t fd,const char *buf, size_t len, off_t offset);
 	void truncateFile(const std::string &id, size_t size, off_t newSize);
-	void createFile(const std::string &id,IReader* content);
+	// Returns length of content. It could differ from expected 'size' (metadata is stale),
+	// only stream ended before its end is an error
+	uint64_t createFile(const std::string &id,IReader* content,uint64_t size=UNKNOWN_SIZE,const Progress &progress=Progress());
 	bool deleteFile(const std::string &id);
 	IReaderPtr readContent(const std::string &id);
 
 private:
 	//bool _fetchFile(const fs::path &fileName,const std::string &id);
+	fs::path _blobFileName(const MD5Signature &md5) const;
+	void _detach(const fs::path &fileName);
+	void _releaseBlob(const MD5Signature &md5);
+	bool _readVersion(const fs::path &fileName,Version &v);
+	void _markWritten(int64_t fd);
+
+	struct Entry
+	{
+		uint64_t size=0;
+		time_t lastAccess=0;
+		size_t hits=0;
+		size_t opened=0;
+		// handles with write access (content isn't linked into blob while they are open)
+		size_t writers=0;
+		size_t downloads=0;
+		bool dirty=false;
+		bool pinned=false;
+	};
+	typedef std::unordered_map<std::string,Entry> Entries;
+	struct OpenedFile
+	{
+		std::string id;
+		bool writable=false;
+	};
+
+	void _scan();
+	Entry &_entry(const std::string &id);
+	void _setSize(Entry &e,uint64_t size);
+	void _evict();
+	uint64_t _limitedBytes() const;
+	bool _deleteFile(const std::string &id);
 
 	fs::path _workDir;
+
+	// Index of cached files (guards by _m)
+	std::mutex _m;
+	Entries _entries;
+	std::unordered_map<int64_t,OpenedFile> _fds;
+	uint64_t _bytes=0;
+	Limits _limits;
+	IOOptions _io;
+	BudgetPtr _budget;
 };
 G2F_DECLARE_PTR(ContentManager);
 
@@ -3,6 +3,7 @@
 #include "utils/decls.h"
 #include "INode.h"
 #include <boost/signals2.hpp>
+#include <boost/utility/string_ref.hpp>
 
 namespace bs2 = boost::signals2;
 
@@ -54,6 +55,11 @@ public:
 	virtual INotifier* getNotifier() =0;
 	virtual INode* getRoot() =0;
 	virtual INode* get(const fs::path &p) =0;
+	// Lookup without building fs::path (hot path of FUSE operations)
+	virtual INode* find(boost::string_ref p)
+	{
+		return get(fs::path(p.begin(),p.end()));
+	}
 	virtual CreateResult createNode(const fs::path &p,bool isDirectory) =0;
 	virtual RemoveStatus removeNode(const fs::path &p) =0;
 	virtual void renameNode(const fs::path &oldPath,const fs::path &newPath) =0;
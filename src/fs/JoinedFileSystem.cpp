@@ -177,8 +177,8 @@ class JoinedFileSystem : public IFileSystem
 				if(itNext==curr->_next.end())
 				{
 					// Build branch
-					_next.push_back(new JoinedNode(curr,*it,mode));
-					curr=&_next.back();
+					curr->_next.push_back(new JoinedNode(curr,*it,mode));
+					curr=&curr->_next.back();
 				}
 				else
 					curr=&*itNext;
@@ -219,6 +219,33 @@ class JoinedFileSystem : public IFileSystem
 			return mp;
 		}
 
+		// The same as above, but 'rest' is tail of path (with leading '/') yet not matched
+		JoinedNode* findMountPoint(boost::string_ref &rest)
+		{
+			JoinedNode *mp=_fs ? this : nullptr;
+			boost::string_ref bckRest=rest;
+
+			JoinedNode *curr=this;
+			while(!rest.empty())
+			{
+				size_t end=std::find(rest.begin()+1,rest.end(),'/')-rest.begin();
+				const boost::string_ref &name=rest.substr(1,end-1);
+				NodeList::iterator itNext=std::find_if(curr->_next.begin(),curr->_next.end(),
+													   [&name](JoinedNode &n){return name==n._name.native();});
+				if(itNext==curr->_next.end())
+					break;
+				curr=&*itNext;
+				rest.remove_prefix(end);
+				if(curr->_fs)
+				{
+					mp=curr;
+					bckRest=rest;
+				}
+			}
+			rest=bckRest;
+			return mp;
+		}
+
 		JoinedNode* findPrevMountPoint()
 		{
 			if(_parent)
@@ -297,6 +324,24 @@ public:
 		return nullptr;
 	}
 
+	virtual INode *find(boost::string_ref path) override
+	{
+		if(_mountedRoot)
+		{
+			if(path=="/")
+				return _mountedRoot.get();
+			boost::string_ref rest=path;
+			JoinedNode *p=_mountedRoot->findMountPoint(rest);
+			if(p)
+			{
+				if(rest.empty() || rest=="/")
+					return p;
+				return p->_fs->find(rest);
+			}
+		}
+		return nullptr;
+	}
+
 	virtual CreateResult createNode(const fs::path &path,bool isDirectory) override
 	{
 		fs::path rest;
@@ -61,7 +61,7 @@ int main(int argc, char *argv[])
 		Enum<Action> action(Service);
 		fs::path confPath;
 		std::string authCode;
-		std::string email;
+		Application::Accounts emails;
 		Application::ProviderArgs prArgs;
 
 		// TODO demonize() app in SERVICE mode
@@ -80,8 +80,8 @@ int main(int argc, char *argv[])
 									G2FMESSAGE("optional application conf directory"))
 			("auth-code",			po::value<std::string>(&authCode),
 									G2FMESSAGE("authorization code was obtained from cloud provider"))
-			("email",				po::value<std::string>(&email),
-									G2FMESSAGE("Provider email account"))
+			("email",				po::value<Application::Accounts>(&emails),
+									G2FMESSAGE("Provider email account (repeat to serve several accounts, each under /<email>)"))
 			;
 
 /*
@@ -113,7 +113,7 @@ FUSE options:
 			return Application::fuseHelp();
 		}
 
-		Application *app=Application::create(email,argc,argv,confPath);
+		Application *app=Application::create(emails,argc,argv,confPath);
 		app->setDebug(vm.count("debug")!=0);
 		app->setReadOnly(vm.count("read-only")!=0);
 
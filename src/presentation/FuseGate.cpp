@@ -1,49 +1,41 @@
-#include "handler.h"
 #include "FuseGate.h"
 #include "utils/log.h"
-#include "utils/ExponentialBackoff.h"
 #include "error/G2FException.h"
 #include "error/appError.h"
 #include "utils/assets.h"
 #include "fs/ConfFileSystem.h"
 #include "fs/JoinedFileSystem.h"
+#include <fcntl.h>
+#include <string.h>
+#include <iostream>
 
 
-FuseGate::FuseGate(IProviderSession &ps)
-	: _ps(ps)
-{}
-
-int FuseGate::run(const FUSEOpts &fuseOpts)
+FuseGate::FuseGate(const Sessions &sessions)
+	: _sessions(sessions)
 {
-	fuse_args args=FUSE_ARGS_INIT(0,NULL);
-	fuse_opt_add_arg(&args,G2F_APP_NAME);
-	if(fuseOpts.debug)
-		fuse_opt_add_arg(&args,"-d");
-	if(fuseOpts.foreground)
-		fuse_opt_add_arg(&args,"-f");
-	if(fuseOpts.disableMThread)
-		fuse_opt_add_arg(&args,"-s");
-	for(const std::string& o : fuseOpts.ooo)
-	{
-		fuse_opt_add_arg(&args,"-o");
-		fuse_opt_add_arg(&args,o.c_str());
-	}
-	if(!fuseOpts.mountPoint.empty())
-		fuse_opt_add_arg(&args,fuseOpts.mountPoint.string().c_str());
-
-	fuse_operations g2f_oper;
-	g2f_init_ops(&g2f_oper);
+	if(_sessions.empty())
+		G2F_EXCEPTION("No account to mount").throwIt(G2FErrorCodes::WrongAppArguments);
+}
 
-	const IFileSystemPtr &confFS=createConfigurationFS(_ps.getConfiguration());
-	const auto &cd=_ps.getConfiguration()->getProperty("control_dir");
+void FuseGate::prepare()
+{
+	// global properties, they are the same for all sessions
+	IConfiguration &globalConf=*_sessions.begin()->second->getConfiguration();
+	_opDeadline=getPropertyAs<size_t>(globalConf,"op_deadline",60)*1000;
+	_ioPolicy=IOPolicy(getPropertyAs<std::string>(globalConf,"io_policy",""));
+	_readAhead=getPropertyAs<size_t>(globalConf,"fuse_read_ahead",0)*1024;
 
 	JoinedFileSystemFactory jfsf(S_IRWXU|S_IRGRP|S_IXGRP);
-	// TODO Make permissions configurable
-	jfsf.mount("/",_ps.getFileSystem(),S_IRWXU|S_IRGRP|S_IXGRP);
-	jfsf.mount(*cd,confFS,S_IRUSR|S_IXUSR|S_IRGRP|S_IXGRP);
+	for(const auto &s : _sessions)
+	{
+		const IConfigurationPtr &conf=s.second->getConfiguration();
+		const fs::path &root=_sessions.size()>1 ? fs::path("/")/s.first : fs::path("/");
+		const auto &cd=conf->getProperty("control_dir");
+		// TODO Make permissions configurable
+		jfsf.mount(root,s.second->getFileSystem(),S_IRWXU|S_IRGRP|S_IXGRP);
+		jfsf.mount(root/fs::path(*cd).relative_path(),createConfigurationFS(conf),S_IRUSR|S_IXUSR|S_IRGRP|S_IXGRP);
+	}
 	_fs=jfsf.build();
-
-	return fuse_main(args.argc, args.argv, &g2f_oper, this);
 }
 
 IFileSystem &FuseGate::getFS()
@@ -51,11 +43,57 @@ IFileSystem &FuseGate::getFS()
 	return *_fs;
 }
 
+size_t FuseGate::getOpDeadline() const
+{
+	return _opDeadline;
+}
+
+IOPolicy::Options FuseGate::getIOOptions(const char *path,int flags,IContentHandle &chn)
+{
+	struct stat st;
+	memset(&st,0,sizeof(st));
+	chn.fillAttr(st);
+	IOPolicy::Options ret=_ioPolicy.match(path,chn.getMeta()->getNodeType(),st.st_size);
+	// content handle knows when page cache would cut reads
+	ret.directIO=ret.directIO || chn.useDirectIO();
+
+	// Page cache is kept while file is the same as at last open. Change feed updates
+	// modification time of node, so the next open drops stale pages. Files are tracked by id,
+	// so version follows renames
+	const std::string &id=chn.getMeta()->getId();
+	if(id.empty())
+		return ret;
+	const OpenedVersion curr={st.st_mtim,st.st_size};
+	std::lock_guard<std::mutex> lock(_openedM);
+	auto it=_opened.find(id);
+	bool same=it!=_opened.end() &&
+			  it->second.size==curr.size &&
+			  it->second.modified.tv_sec==curr.modified.tv_sec &&
+			  it->second.modified.tv_nsec==curr.modified.tv_nsec;
+	if(same)
+		ret.keepCache=true;
+	else
+	{
+		// forgotten version only makes the next open drop page cache
+		if(it==_opened.end() && _opened.size()>=MAX_OPENED)
+			_opened.clear();
+		_opened[id]=curr;
+	}
+	if(flags & O_TRUNC)
+		ret.keepCache=false;
+	return ret;
+}
+
+size_t FuseGate::getReadAhead() const
+{
+	return _readAhead;
+}
+
 INode *FuseGate::getINode(const char *path)
 {
 	try
 	{
-		return _fs->get(path);
+		return _fs->find(path);
 	}
 	catch(const G2FException &e)
 	{
@@ -69,7 +107,7 @@ posix_error_code FuseGate::openContent(const char *path, int flags, IContentHand
 	posix_error_code err=0;
 	try
 	{
-		INode *n=_fs->get(path);
+		INode *n=_fs->find(path);
 		if(!n)
 			return ENOENT;
 		if(n->isFolder())
@@ -140,9 +178,15 @@ posix_error_code FuseGate::removeINode(const char *path)
 {
 	try
 	{
+		INode *n=_fs->find(path);
+		const std::string &id=n ? n->getId() : std::string();
 		IFileSystem::RemoveStatus ret=_fs->removeNode(path);
 		if(ret==IFileSystem::RemoveStatus::RemoveSuccess)
+		{
+			std::lock_guard<std::mutex> lock(_openedM);
+			_opened.erase(id);
 			return 0;
+		}
 		if(ret==IFileSystem::RemoveStatus::RemoveNotFound)
 			return ENOENT;
 		//if(ret==IFileSystem::RemoveStatus::Forbidden)
@@ -202,13 +246,3 @@ posix_error_code FuseGate::rename(const char *oldName, const char *newName)
 	return 0;
 }
 
-int FuseGate::fuseHelp()
-{
-	fuse_args args=FUSE_ARGS_INIT(0,NULL);
-	fuse_opt_add_arg(&args,G2F_APP_NAME);
-	fuse_opt_add_arg(&args,"-ho");	// Omit fuse help header
-	fuse_operations ops;
-	memset(&ops,0,sizeof(fuse_operations));
-	return fuse_main(args.argc, args.argv, &ops, 0);
-}
-
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include "utils/decls.h"
 #include "control/FuseOpts.h"
 #include "fs/IFileSystem.h"
 #include "cache/Cache.h"
 #include "providers/IProviderSession.h"
+#include "IOPolicy.h"
 
 
 class GoogleSource;
@@ -12,10 +16,22 @@ class GoogleSource;
 class FuseGate
 {
 public:
-	FuseGate(IProviderSession &ps);
+	// Account name -> session
+	typedef std::map<std::string,IProviderSessionPtr> Sessions;
+
+	// Single account is mounted at root, several ones - each at directory named by account
+	FuseGate(const Sessions &sessions);
 	int run(const FUSEOpts &fuseOpts);
+	// Reads global properties and joins file systems of sessions, run() calls it before mount
+	void prepare();
 
 	IFileSystem& getFS();
+	// Time budget of single file operation (msec)
+	size_t getOpDeadline() const;
+	// Kernel caching of opened file
+	IOPolicy::Options getIOOptions(const char *path,int flags,IContentHandle &chn);
+	// Max kernel read-ahead (bytes, 0 - kernel default)
+	size_t getReadAhead() const;
 
 	INode *getINode(const char *path);
 	posix_error_code openContent(const char *path,int flags, IContentHandle *&outChn);
@@ -27,7 +43,20 @@ public:
 	static int fuseHelp();
 
 private:
-	IProviderSession &_ps;
+	Sessions _sessions;
 	IFileSystemPtr _fs;
+	size_t _opDeadline=0;
+	IOPolicy _ioPolicy;
+	size_t _readAhead=0;
+	// Modification time and size of file at last open (id -> version)
+	struct OpenedVersion
+	{
+		timespec modified;
+		off_t size;
+	};
+	// bound of tracked files, versions are forgotten all at once on reaching it
+	static const size_t MAX_OPENED=64*1024;
+	std::mutex _openedM;
+	std::unordered_map<std::string,OpenedVersion> _opened;
 };
 
@@ -0,0 +1,108 @@
+#include "IOPolicy.h"
+#include "error/G2FException.h"
+#include "error/appError.h"
+#include <fnmatch.h>
+#include <boost/algorithm/string.hpp>
+
+namespace
+{
+
+uint64_t parseSize(const std::string &value)
+{
+	size_t pos=0;
+	uint64_t ret=std::stoull(value,&pos);
+	const std::string &suffix=boost::to_upper_copy(value.substr(pos));
+	if(suffix=="K")
+		ret<<=10;
+	else if(suffix=="M")
+		ret<<=20;
+	else if(suffix=="G")
+		ret<<=30;
+	else if(!suffix.empty())
+		throw std::invalid_argument(value);
+	return ret;
+}
+
+}
+
+
+
+
+
+IOPolicy::IOPolicy(const std::string &rules)
+{
+	std::vector<std::string> items;
+	boost::split(items,rules,boost::is_any_of(";"));
+	for(std::string &r : items)
+	{
+		boost::trim(r);
+		if(!r.empty())
+			_rules.push_back(_parse(r));
+	}
+}
+
+IOPolicy::Options IOPolicy::match(const char *path,INode::NodeType type,uint64_t size) const
+{
+	for(const Rule &r : _rules)
+	{
+		if(size<r.minSize || size>=r.maxSize)
+			continue;
+		if(!r.anyType && type!=r.type)
+			continue;
+		if(!r.glob.empty() && fnmatch(r.glob.c_str(),path,0)!=0 && fnmatch((r.glob+"/*").c_str(),path,0)!=0)
+			continue;
+		return r.options;
+	}
+	return Options();
+}
+
+IOPolicy::Rule IOPolicy::_parse(const std::string &rule)
+{
+	Rule ret;
+	size_t colon=rule.rfind(':');
+	if(colon==std::string::npos)
+		G2F_EXCEPTION("IO policy: rule '%1' has no options").arg(rule).throwIt(G2FErrorCodes::WrongAppArguments);
+
+	std::vector<std::string> conds;
+	const std::string &condStr=boost::trim_copy(rule.substr(0,colon));
+	if(!condStr.empty())
+		boost::split(conds,condStr,boost::is_space(),boost::token_compress_on);
+	try
+	{
+		for(const std::string &c : conds)
+		{
+			if(boost::starts_with(c,"size>="))
+				ret.minSize=parseSize(c.substr(6));
+			else if(boost::starts_with(c,"size<"))
+				ret.maxSize=parseSize(c.substr(5));
+			else if(boost::starts_with(c,"path="))
+				ret.glob=c.substr(5);
+			else if(c=="type=binary" || c=="type=exported" || c=="type=shortcut")
+			{
+				ret.anyType=false;
+				ret.type=c=="type=binary" ? INode::NodeType::Binary :
+						 c=="type=exported" ? INode::NodeType::Exported : INode::NodeType::Shortcut;
+			}
+			else
+				throw std::invalid_argument(c);
+		}
+	}
+	catch(const std::logic_error&)
+	{
+		G2F_EXCEPTION("IO policy: wrong condition in rule '%1'").arg(rule).throwIt(G2FErrorCodes::WrongAppArguments);
+	}
+
+	std::vector<std::string> opts;
+	boost::split(opts,rule.substr(colon+1),boost::is_any_of(","));
+	for(std::string &o : opts)
+	{
+		boost::trim(o);
+		if(o=="direct_io")
+			ret.options.directIO=true;
+		else if(o=="keep_cache")
+			ret.options.keepCache=true;
+		else if(!o.empty())
+			G2F_EXCEPTION("IO policy: unknown option '%1'").arg(o).throwIt(G2FErrorCodes::WrongAppArguments);
+	}
+	return ret;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "fs/INode.h"
+
+/**
+ * @brief Rules of kernel caching of opened files
+ *
+ * Rules are separated by ';', the first matched rule wins:
+ *   <conditions>:<options>
+ * Conditions are separated by spaces, all of them must match:
+ *   size>=<N>, size<<N>	size of file (suffixes K, M, G are allowed)
+ *   type=<binary|exported|shortcut>
+ *   path=<glob>			glob of directory matches all its content
+ * Options are separated by ',':
+ *   direct_io		reads bypass page cache
+ *   keep_cache		page cache isn't dropped on open even if file has changed
+ *					(without it the cache is kept only for unchanged file)
+ *
+ * Example: "size>=256M:direct_io; path=/etc/conf.d:keep_cache"
+ *********************************************************************/
+class IOPolicy
+{
+public:
+	struct Options
+	{
+		bool directIO=false;
+		bool keepCache=false;
+	};
+
+	// Throws G2FException on wrong rules
+	IOPolicy(const std::string &rules=std::string());
+
+	Options match(const char *path,INode::NodeType type,uint64_t size) const;
+
+private:
+	struct Rule
+	{
+		uint64_t minSize=0;
+		uint64_t maxSize=UINT64_MAX;	// exclusive
+		bool anyType=true;
+		INode::NodeType type=INode::NodeType::Binary;
+		std::string glob;
+		Options options;
+	};
+
+	static Rule _parse(const std::string &rule);
+
+	std::vector<Rule> _rules;
+};
@@ -1,6 +1,8 @@
 #include "utils/log.h"
 #include "FuseGate.h"
 #include "handler.h"
+#include "utils/Deadline.h"
+#include <algorithm>
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
@@ -19,6 +21,8 @@
 #define FH_TO_NODEPTR(fh, nptr) (nptr=reinterpret_cast<INode*>(fh))
 #define CONTENTHANDLEPTR_2_FH(chn) (reinterpret_cast<int64_t>(chn))
 #define FH_2_CONTENTHANDLEPTR(fh) (reinterpret_cast<IContentHandle*>(fh))
+// Limits time of retrying cloud requests made by current operation
+#define G2F_OP_DEADLINE() Deadline::Scope _g2fDeadline(G2F_DATA->getOpDeadline())
 
 /** Get file attributes.
   *
@@ -29,6 +33,7 @@
 int g2f_getattr(const char *path, struct stat * statbuf)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path);
 	INode *n=G2F_DATA->getINode(path);
 	if(!n)
@@ -55,6 +60,7 @@ int g2f_getattr(const char *path, struct stat * statbuf)
 int g2f_opendir (const char *path, struct fuse_file_info *fi)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path);
 	INode *n=G2F_DATA->getINode(path);
 	if(!n)
@@ -90,6 +96,7 @@ int g2f_readdir (const char *path, void *buf, fuse_fill_dir_t filler, off_t offs
 				 struct fuse_file_info *fi)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", offset=" << offset);
 	INode *n=0;
 	FH_TO_NODEPTR(fi->fh,n);
@@ -148,13 +155,16 @@ int g2f_releasedir (const char *path, struct fuse_file_info *fi)
 int g2f_open (const char *path, struct fuse_file_info *fi)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", flags=" << fi->flags);
 	IContentHandle *chn=nullptr;
 	int err=G2F_DATA->openContent(path,fi->flags,chn);
 	if(!err)
 	{
+		const IOPolicy::Options &io=G2F_DATA->getIOOptions(path,fi->flags,*chn);
 		fi->nonseekable=0;
-		fi->direct_io=chn->useDirectIO()?1:0;
+		fi->direct_io=io.directIO?1:0;
+		fi->keep_cache=io.keepCache?1:0;
 		fi->fh=CONTENTHANDLEPTR_2_FH(chn);
 	}
 
@@ -202,6 +212,7 @@ int g2f_read (const char *path, char *buf, size_t size, off_t offset, struct fus
 int g2f_release (const char *path, struct fuse_file_info *fi)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", fd=" << fi->fh);
 	IContentHandle *chn=FH_2_CONTENTHANDLEPTR(fi->fh);
 	chn->close();
@@ -238,6 +249,7 @@ int g2f_fgetattr (const char *path, struct stat *statbuf, struct fuse_file_info
 int g2f_truncate (const char *path, off_t newSize)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", newSize=" << newSize);
 
 	INode *n=G2F_DATA->getINode(path);
@@ -268,6 +280,7 @@ int g2f_truncate (const char *path, off_t newSize)
 int g2f_create (const char *path, mode_t mode, struct fuse_file_info *fi)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", mode= " << mode << ", flags=" << fi->flags);
 
 	// NOTE Implement transactions
@@ -308,6 +321,7 @@ int g2f_create (const char *path, mode_t mode, struct fuse_file_info *fi)
 int g2f_access (const char *path, int mask)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", mask=" << mask);
 	INode *f=G2F_DATA->getINode(path);
 	if(!f)
@@ -341,6 +355,7 @@ int g2f_write (const char *path, const char *buf, size_t size, off_t offset,
 int g2f_unlink (const char *path)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path);
 	posix_error_code err=G2F_DATA->removeINode(path);
 	G2F_LOG("errno=" << err);
@@ -356,6 +371,7 @@ int g2f_unlink (const char *path)
 int g2f_mkdir(const char *path, mode_t mode)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", mode=" << mode);
 
 
@@ -370,6 +386,7 @@ int g2f_mkdir(const char *path, mode_t mode)
 int g2f_rmdir (const char *path)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path);
 	posix_error_code err=G2F_DATA->removeINode(path);
 	G2F_LOG("errno=" << err);
@@ -402,6 +419,7 @@ int g2f_rmdir (const char *path)
 int g2f_flush (const char *path, struct fuse_file_info *fi)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", fd=" << fi->fh);
 
 	int err=FH_2_CONTENTHANDLEPTR(fi->fh)->flush();
@@ -413,6 +431,7 @@ int g2f_flush (const char *path, struct fuse_file_info *fi)
 int g2f_rename (const char *path, const char *newPath)
 {
 	G2F_LOG_SCOPE();
+	G2F_OP_DEADLINE();
 	G2F_LOG("path=" << path << ", newPath=" << newPath);
 	posix_error_code err=G2F_DATA->rename(path,newPath);
 	G2F_LOG("errno=" << err);
@@ -555,7 +574,10 @@ void *g2f_init (struct fuse_conn_info *conn)
 {
 	G2F_LOG_SCOPE();
 	conn->async_read=0;
-	G2F_LOG("called");
+	// kernel can only be asked to read ahead less
+	if(size_t readAhead=G2F_DATA->getReadAhead())
+		conn->max_readahead=std::min<size_t>(conn->max_readahead,readAhead);
+	G2F_LOG("called, max_readahead=" << conn->max_readahead);
 	return G2F_DATA;
 }
 
@@ -777,6 +799,7 @@ int g2f_fallocate (const char *path, int mode, off_t offset, off_t len,
 
 
 
+
 void g2f_clear_ops(fuse_operations* ops)
 {
 	memset(ops,0,sizeof(fuse_operations));
@@ -827,3 +850,42 @@ void g2f_init_ops(fuse_operations* ops)
 	//ops->flock = g2f_flock;
 	//ops->fallocate = g2f_fallocate;
 }
+
+
+
+
+// FUSE entry points of gate (the rest of FuseGate doesn't depend on libfuse)
+int FuseGate::run(const FUSEOpts &fuseOpts)
+{
+	fuse_args args=FUSE_ARGS_INIT(0,NULL);
+	fuse_opt_add_arg(&args,G2F_APP_NAME);
+	if(fuseOpts.debug)
+		fuse_opt_add_arg(&args,"-d");
+	if(fuseOpts.foreground)
+		fuse_opt_add_arg(&args,"-f");
+	if(fuseOpts.disableMThread)
+		fuse_opt_add_arg(&args,"-s");
+	for(const std::string& o : fuseOpts.ooo)
+	{
+		fuse_opt_add_arg(&args,"-o");
+		fuse_opt_add_arg(&args,o.c_str());
+	}
+	if(!fuseOpts.mountPoint.empty())
+		fuse_opt_add_arg(&args,fuseOpts.mountPoint.string().c_str());
+
+	fuse_operations g2f_oper;
+	g2f_init_ops(&g2f_oper);
+	prepare();
+
+	return fuse_main(args.argc, args.argv, &g2f_oper, this);
+}
+
+int FuseGate::fuseHelp()
+{
+	fuse_args args=FUSE_ARGS_INIT(0,NULL);
+	fuse_opt_add_arg(&args,G2F_APP_NAME);
+	fuse_opt_add_arg(&args,"-ho");	// Omit fuse help header
+	fuse_operations ops;
+	memset(&ops,0,sizeof(fuse_operations));
+	return fuse_main(args.argc, args.argv, &ops, 0);
+}
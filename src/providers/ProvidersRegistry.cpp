@@ -28,6 +28,8 @@ IProviderFactoryPtr ProvidersRegistry::detectByAccountName(const std::string &ac
 {
 	if(accName.find("gmail")!=std::string::npos)
 		return find("gdrive");
+	if(boost::starts_with(accName,"memory"))
+		return find("memory");
 	return IProviderFactoryPtr();
 }
 
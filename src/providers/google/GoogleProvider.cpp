@@ -6,8 +6,13 @@
 #include "error/G2FException.h"
 #include "control/props/AbstractMemoryStaticInitPropertiesList.h"
 #include "control/ChainedCofiguration.h"
+#include "control/props/RuntimePropertiesList.h"
 #include "control/paths/PathManager.h"
 #include "fs/AbstractFileSystem.h"
+#include "fs/CacheWarmer.h"
+#include "fs/ChangeSync.h"
+#include "fs/JoinedFileSystem.h"
+#include "utils/RetryEngine.h"
 
 #include "providers/google/Auth.h"
 #include <googleapis/client/util/status.h>
@@ -22,10 +27,21 @@
 #include <googleapis/client/transport/http_transport.h>
 #include <google/drive_api/drive_service.h>
 #include <googleapis/client/transport/http_authorization.h>
+#include <googleapis/client/util/uri_template.h>
 #include "googleapis/base/integral_types.h"
+#include <json/reader.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/hex.hpp>
+#include <boost/format.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <sys/stat.h>
 
 namespace g_api=googleapis;
 namespace g_cli=googleapis::client;
@@ -46,6 +62,9 @@ const std::string ID_ROOT("root");
 const std::string FILE_RESOURCE_FIELD("id,etag,title,mimeType,createdDate,modifiedDate,lastViewedByMeDate,originalFilename,fileSize,md5Checksum");
 MimePair FOLDER_MIME("application","vnd.google-apps.folder");
 MimePair GOOGLE_DOC("application","vnd.google-apps.document");
+MimePair GOOGLE_SHEET("application","vnd.google-apps.spreadsheet");
+MimePair GOOGLE_DRAWING("application","vnd.google-apps.drawing");
+MimePair GOOGLE_SLIDES("application","vnd.google-apps.presentation");
 MimePair SHORTCUT("application","vnd.google-apps.drive-sdk");
 
 void gdt2timespec(const g_cli::DateTime &from, timespec &to)
@@ -77,11 +96,61 @@ std::string getMimeType(const MimePair &mp)
 }
 
 
+// Kind of GDoc is the suffix of 'export_gdoc_*' property (empty for not GDoc)
+std::string getDocKind(const MimePair &mp)
+{
+	if(mp==GOOGLE_DOC)
+		return "documents";
+	if(mp==GOOGLE_SHEET)
+		return "spreadsheets";
+	if(mp==GOOGLE_DRAWING)
+		return "drawings";
+	if(mp==GOOGLE_SLIDES)
+		return "presentations";
+	return std::string();
+}
+
+// MIME type of export format (values of 'export_gdoc_*' properties)
+std::string getExportMime(const std::string &format)
+{
+	static const std::map<std::string,std::string> formats=
+	{
+		{"html",			"text/html"},
+		{"plain_text",		"text/plain"},
+		{"rich_text",		"application/rtf"},
+		{"openoffice_doc",	"application/vnd.oasis.opendocument.text"},
+		{"pdf",				"application/pdf"},
+		{"ms_word",			"application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+		{"csv",				"text/csv"},
+		{"openoffice_sheet","application/x-vnd.oasis.opendocument.spreadsheet"},
+		{"ms_excel",		"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+		{"jpeg",			"image/jpeg"},
+		{"png",				"image/png"},
+		{"svg",				"image/svg+xml"},
+		{"ms_powerpoint",	"application/vnd.openxmlformats-officedocument.presentationml.presentation"}
+	};
+	auto it=formats.find(format);
+	return it!=formats.end() ? it->second : std::string();
+}
+
+std::string escapeQueryValue(const std::string &value)
+{
+	std::string ret;
+	for(char c : value)
+	{
+		if(isalnum(static_cast<unsigned char>(c)) || c=='-' || c=='_' || c=='.' || c=='~')
+			ret+=c;
+		else
+			ret+=(boost::format("%%%02X") % static_cast<int>(static_cast<unsigned char>(c))).str();
+	}
+	return ret;
+}
+
 INode::NodeType getFileType(const MimePair &mp)
 {
 	if(mp==FOLDER_MIME)
 		return INode::NodeType::Directory;
-	if(mp==GOOGLE_DOC)
+	if(!getDocKind(mp).empty())
 		return INode::NodeType::Exported;
 	if(mp==SHORTCUT)
 		return INode::NodeType::Shortcut;
@@ -133,28 +202,26 @@ G2FError checkHttpResponse(const g_cli::HttpRequest* request)
 			ret.setDetail(status.error_message());
 			return ret;
 		}*/
-		if(httpCode>=400 && httpCode<500)
-			ret=G2FErrorCodes::HttpClientError;
+		// Quota errors come as 429 or as 403 with 'rateLimitExceeded'/'userRateLimitExceeded' reason
+		// (see https://developers.google.com/drive/v3/web/handle-errors)
+		std::string body;
+		if(httpCode==403)
+			response->GetBodyString(&body);
+		if(httpCode==429 || (httpCode==403 && boost::algorithm::icontains(body,"ratelimitexceeded")))
+			ret=G2FErrorCodes::HttpRateLimitError;
 		else
 		if(httpCode>=401 && httpCode<=403)
 			ret=G2FErrorCodes::HttpPermissionError;
 		else
 		if(httpCode==408)
 			ret=G2FErrorCodes::HttpTimeoutError;
+		else
+		if(httpCode>=400 && httpCode<500)
+			ret=G2FErrorCodes::HttpClientError;
 		if(httpCode>=500 && httpCode<600)
 			ret=G2FErrorCodes::HttpServerError;
 		ret.setDetail(request->url());
 
-		// TODO Using exponential backoff
-		// Detect necessity of using of exponential backoff (see https://developers.google.com/drive/v3/web/handle-errors#exponential-backoff)
-		// try parse content as JSON or decode content-type
-		/*g_cli::JsonCppCapsule<g_cli::JsonCppData> jsonData;
-		googleapis::util::Status status=jsonData.LoadFromJsonReader(response->body_reader());
-		if(!status.ok())
-		{
-			ret=G2FErrorCodes::InternalError;
-			return ret;
-		}*/
 		// Restore offset in case someone downstream wants to read the body again.
 		if (!response->body_reader()->Reset())
 			ret=G2FErrorCodes::InternalError;
@@ -202,6 +269,141 @@ protected:
 
 
 
+/**
+ * @brief Request of GDoc content converted to another format
+ *
+ * Drive API v2 'files/{fileId}/export' method (isn't generated in client library)
+ *
+ *****************************************************/
+class ExportMethod : public g_drv::DriveServiceBaseRequest
+{
+public:
+	ExportMethod(const g_drv::DriveService *service,g_cli::AuthorizationCredential *credential,
+				 const std::string &fileId,const std::string &mimeType)
+		: DriveServiceBaseRequest(service,credential,g_cli::HttpRequest::GET,"files/{fileId}/export"),
+		  _fileId(fileId),
+		  _mimeType(mimeType)
+	{}
+
+protected:
+	virtual g_utl::Status AppendVariable(const std::string &variableName,const g_cli::UriTemplateConfig &config,std::string *target) override
+	{
+		if(variableName=="fileId")
+		{
+			g_cli::UriTemplate::AppendValue(_fileId,config,target);
+			return g_cli::StatusOk();
+		}
+		return DriveServiceBaseRequest::AppendVariable(variableName,config,target);
+	}
+
+	virtual g_utl::Status AppendOptionalQueryParameters(std::string *target) override
+	{
+		target->append("?mimeType=");
+		target->append(escapeQueryValue(_mimeType));
+		return DriveServiceBaseRequest::AppendOptionalQueryParameters(target);
+	}
+
+private:
+	std::string _fileId;
+	std::string _mimeType;
+};
+
+
+
+
+
+/**
+ * @brief Scope of request to shared drive
+ *
+ *****************************************************/
+enum class DriveScope
+{
+	Item,		// request addresses file of shared drive
+	Listing,	// request lists files of shared drive
+	Changes		// request lists changes of shared drive
+};
+
+/**
+ * @brief Generated method which can address shared drive
+ *
+ * Client library is generated before shared drives, so it hasn't
+ * 'supportsAllDrives', 'driveId' etc. parameters. They are appended
+ * to query here when drive id isn't empty (My Drive).
+ *
+ *****************************************************/
+template<typename Method>
+class DriveScoped : public Method
+{
+public:
+	template<typename... Args>
+	DriveScoped(DriveScope scope,const std::string &driveId,Args&&... args)
+		: Method(std::forward<Args>(args)...),
+		  _scope(scope),
+		  _driveId(driveId)
+	{}
+
+protected:
+	virtual g_utl::Status AppendOptionalQueryParameters(std::string *target) override
+	{
+		g_utl::Status s=Method::AppendOptionalQueryParameters(target);
+		if(!s.ok() || _driveId.empty())
+			return s;
+
+		target->append(target->find('?')==std::string::npos ? "?" : "&");
+		target->append("supportsAllDrives=true");
+		if(_scope!=DriveScope::Item)
+		{
+			target->append("&includeItemsFromAllDrives=true&driveId=");
+			target->append(escapeQueryValue(_driveId));
+		}
+		if(_scope==DriveScope::Listing)
+			target->append("&corpora=drive");
+		return s;
+	}
+
+private:
+	DriveScope _scope;
+	std::string _driveId;
+};
+
+
+
+
+
+/**
+ * @brief Request of list of shared drives
+ *
+ * Drive API v2 'drives' method (isn't generated in client library)
+ *
+ *****************************************************/
+class DrivesListMethod : public g_drv::DriveServiceBaseRequest
+{
+public:
+	DrivesListMethod(const g_drv::DriveService *service,g_cli::AuthorizationCredential *credential,const std::string &pageToken)
+		: DriveServiceBaseRequest(service,credential,g_cli::HttpRequest::GET,"drives"),
+		  _pageToken(pageToken)
+	{}
+
+protected:
+	virtual g_utl::Status AppendOptionalQueryParameters(std::string *target) override
+	{
+		target->append("?maxResults=100");
+		if(!_pageToken.empty())
+		{
+			target->append("&pageToken=");
+			target->append(escapeQueryValue(_pageToken));
+		}
+		return DriveServiceBaseRequest::AppendOptionalQueryParameters(target);
+	}
+
+private:
+	std::string _pageToken;
+};
+
+
+
+
+
 /**
  * @brief Data Reader
  *
@@ -209,14 +411,21 @@ protected:
 class ContentReader : public ContentManager::IReader
 {
 public:
-	ContentReader(uptr<g_drv::FilesResource_GetMethod> method)
-		: _method(std::move(method))
+	typedef std::function<g_cli::ClientServiceRequest*()> MethodFactory;
+
+	ContentReader(const MethodFactory &factory,const RetryEnginePtr &retry)
+		: _factory(factory),
+		  _retry(retry)
 	{}
 
 // IReader interface
 	virtual bool done() override
 	{
-		return reader()->done();
+		const bool ret=reader()->done();
+		// Body is read, so the next download may use the media slot
+		if(ret)
+			_slot.release(reader()->ok() ? AdaptiveLimiter::Success : AdaptiveLimiter::Failed);
+		return ret;
 	}
 	virtual int64_t read(char *buffer, int64_t bufSize) override
 	{
@@ -226,6 +435,7 @@ public:
 	{
 		if(reader()->ok())
 			return G2FError();
+		_slot.release(AdaptiveLimiter::Failed);
 
 		G2FError ret;
 		ret=G2FErrorCodes::HttpReadError;
@@ -235,15 +445,24 @@ public:
 	}
 
 private:
-	uptr<g_drv::FilesResource_GetMethod> _method;
+	MethodFactory _factory;
+	RetryEnginePtr _retry;
+	uptr<g_cli::ClientServiceRequest> _method;
 	g_cli::DataReader *_reader=0;
+	// Media channel is limited until body is streamed, not only until headers arrive
+	RetryEngine::Slot _slot;
 
 	g_cli::DataReader *reader()
 	{
 		if(!_reader)
 		{
-			_method->Execute();
-			const G2FError &e=checkHttpResponse(_method->mutable_http_request());
+			const G2FError &e=_retry->execute([this]()
+			{
+				// Request can't be reexecuted, so it's recreated on each attempt
+				_method.reset(_factory());
+				_method->Execute();
+				return checkHttpResponse(_method->mutable_http_request());
+			},RetryEngine::Media,&_slot);
 			if(e)
 				G2FExceptionBuilder("Fail to read data from Google Drive").throwIt(e);
 			g_cli::HttpResponse *resp=_method->mutable_http_request()->response();
@@ -271,10 +490,12 @@ class GoogleFileSystem : public AbstractFileSystem
 public:
 	GoogleFileSystem(const ContentManagerPtr &cm,
 					 sptr<g_drv::DriveService> service,
-					 OAuth2CredentialPtr authCred)
+					 OAuth2CredentialPtr authCred,
+					 const RetryEnginePtr &retry)
 		: AbstractFileSystem(cm),
 		  _service(service),
-		  _authCred(authCred)
+		  _authCred(authCred),
+		  _retry(retry)
 	{}
 
 	class GoogleReader : public g_cli::DataReader
@@ -316,12 +537,17 @@ public:
 protected:
 	virtual void cloudFetchMeta(Node &dest) override
 	{
-		uptr<g_drv::FilesResource_GetMethod> lm(_service->get_files().NewGetMethod(_authCred.get(),dest.getId()));
-		lm->set_fields(FILE_RESOURCE_FIELD);
-		lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
-		uptr<g_drv::File> file(g_drv::File::New());
-		const g_utl::Status& s=lm->ExecuteAndParseResponse(file.get());
-		const G2FError &e=checkHttpResponse(lm->http_request());
+		uptr<g_drv::File> file;
+		const G2FError &e=_retry->execute([&]()
+		{
+			uptr<g_drv::FilesResource_GetMethod> lm(new DriveScoped<g_drv::FilesResource_GetMethod>(DriveScope::Item,_driveId,
+																									  _service.get(),_authCred.get(),_cloudId(dest.getId())));
+			lm->set_fields(FILE_RESOURCE_FIELD);
+			lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+			file.reset(g_drv::File::New());
+			const g_utl::Status& s=lm->ExecuteAndParseResponse(file.get());
+			return checkHttpResponse(lm->http_request());
+		});
 		if(e.isError())
 			G2FExceptionBuilder("GoogleFS: fail to get node description").throwIt(e);
 
@@ -332,9 +558,16 @@ protected:
 	void fillNode(g_drv::File &source,Node &dest)
 	{
 		dest.setId(source.get_id().ToString());
+		dest.setEtag(source.get_etag().ToString());
 		dest.setName(source.get_title().ToString());
-		INode::NodeType ft=getFileType(splitMime(source.get_mime_type().ToString()));
+		const MimePair &mime=splitMime(source.get_mime_type().ToString());
+		INode::NodeType ft=getFileType(mime);
 		dest.setFileType(ft);
+		if(ft==INode::NodeType::Exported)
+		{
+			std::lock_guard<std::mutex> lock(_docKindsM);
+			_docKinds[dest.getId()]=getDocKind(mime);
+		}
 
 		timespec ts;
 		//gdt2timespec(source.get_created_date(),ts);
@@ -362,13 +595,26 @@ protected:
 	virtual std::vector<std::string> cloudFetchChildrenList(const std::string &parentId) override
 	{
 		std::vector<std::string> ret;
+		if(!_driveId.empty())
+		{
+			// children resource doesn't list shared drive
+			Changes children;
+			_listFiles("'"+_cloudId(parentId)+"' in parents and trashed=false",children);
+			for(Change &c : children)
+				ret.push_back(c.id);
+			return ret;
+		}
 
-		uptr<g_drv::ChildrenResource_ListMethod> lm(_service->get_children().NewListMethod(_authCred.get(),parentId));
-		lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
-		lm->set_fields("etag,items(id)");
-		uptr<g_drv::ChildList> data(g_drv::ChildList::New());
-		const g_utl::Status& s=lm->ExecuteAndParseResponse(data.get());
-		const G2FError &e=checkHttpResponse(lm->http_request());
+		uptr<g_drv::ChildList> data;
+		const G2FError &e=_retry->execute([&]()
+		{
+			uptr<g_drv::ChildrenResource_ListMethod> lm(_service->get_children().NewListMethod(_authCred.get(),parentId));
+			lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+			lm->set_fields("etag,items(id)");
+			data.reset(g_drv::ChildList::New());
+			const g_utl::Status& s=lm->ExecuteAndParseResponse(data.get());
+			return checkHttpResponse(lm->http_request());
+		});
 		if(e)
 			G2FExceptionBuilder("GoogleFS: Error reading children list").throwIt(e);
 
@@ -396,7 +642,7 @@ protected:
 
 		Json::Value jRefStorage;
 		g_drv::ParentReference pref(&jRefStorage);
-		pref.set_id(dest.getParent()->getId());
+		pref.set_id(_cloudId(dest.getParent()->getId()));
 
 		Json::Value jParentsStorage;
 		g_cli::JsonCppArray<g_drv::ParentReference> parents(&jParentsStorage);
@@ -406,16 +652,22 @@ protected:
 		if(dest.isFolder())
 			f.set_mime_type(getMimeType(FOLDER_MIME));
 
-		uptr<g_drv::FilesResource_InsertMethod> lm(_service->get_files().NewInsertMethod(_authCred.get(),
-																						 &f,
-																						 "",
-																						 nullptr));
-		lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
-		lm->set_fields(FILE_RESOURCE_FIELD);
-		uptr<g_drv::File> file(g_drv::File::New());
-
-		const g_utl::Status& s=lm->ExecuteAndParseResponse(file.get());
-		const G2FError &e=checkHttpResponse(lm->mutable_http_request());
+		uptr<g_drv::File> file;
+		const G2FError &e=_retry->execute([&]()
+		{
+			uptr<g_drv::FilesResource_InsertMethod> lm(new DriveScoped<g_drv::FilesResource_InsertMethod>(DriveScope::Item,_driveId,
+																										   _service.get(),
+																										   _authCred.get(),
+																										   &f,
+																										   "",
+																										   nullptr));
+			lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+			lm->set_fields(FILE_RESOURCE_FIELD);
+			file.reset(g_drv::File::New());
+
+			const g_utl::Status& s=lm->ExecuteAndParseResponse(file.get());
+			return checkHttpResponse(lm->mutable_http_request());
+		});
 		if(e)
 			G2FExceptionBuilder("GoogleFS: fail to create node").throwIt(e);
 
@@ -424,10 +676,28 @@ protected:
 
 	virtual ContentManager::IReaderUPtr cloudReadMedia(Node &node) override
 	{
-		uptr<g_drv::FilesResource_GetMethod> lm(_service->get_files().NewGetMethod(_authCred.get(),node.getId()));
-		lm->set_alt("media");
-		lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
-		return std::make_unique<ContentReader>(std::move(lm));
+		const std::string id=node.getId();
+		if(node.getNodeType()==INode::NodeType::Exported)
+		{
+			const std::string &format=cloudExportFormat(node);
+			const std::string &mimeType=getExportMime(format);
+			if(mimeType.empty())
+				G2F_EXCEPTION("GoogleFS: unknown format '%1' of export of '%2'").arg(format).arg(node.getName()).throwIt(G2FErrorCodes::NotImplemented);
+			return std::make_unique<ContentReader>([this,id,mimeType]()
+			{
+				uptr<ExportMethod> lm(new ExportMethod(_service.get(),_authCred.get(),id,mimeType));
+				lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+				return lm.release();
+			},_retry);
+		}
+		return std::make_unique<ContentReader>([this,id]()
+		{
+			uptr<g_drv::FilesResource_GetMethod> lm(new DriveScoped<g_drv::FilesResource_GetMethod>(DriveScope::Item,_driveId,
+																								  _service.get(),_authCred.get(),id));
+			lm->set_alt("media");
+			lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+			return lm.release();
+		},_retry);
 	}
 
 	virtual void cloudUpdate(Node &node,int patchFields,const std::string &mediaType,ContentManager::IReader *content) override
@@ -443,7 +713,7 @@ protected:
 		if(patchFields & Node::Field::Parent)
 		{
 			g_drv::ParentReference pref(&jRefStorage);
-			pref.set_id(node.getParent()->getId());
+			pref.set_id(_cloudId(node.getParent()->getId()));
 
 			g_cli::JsonCppArray<g_drv::ParentReference> parents(&jParentsStorage);
 			parents.set(0,pref);
@@ -471,19 +741,33 @@ protected:
 		if(patchFields)
 			metadata=&f;
 
-		uptr<GoogleReader> dataReader;
-		if(content)
-			dataReader=std::make_unique<GoogleReader>(content);
-
-		// Takes ownership about dataReader
-		uptr<g_drv::FilesResource_UpdateMethod> lm(_service->get_files().NewUpdateMethod(_authCred.get(),
-																						 node.getId(),
-																						 metadata,
-																						 mediaType,
-																						 dataReader.release()));
-		lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
-		lm->Execute();
-		const G2FError &e=checkHttpResponse(lm->mutable_http_request());
+		bool firstAttempt=true;
+		G2FError lastError;
+		const G2FError &e=_retry->execute([&]()
+		{
+			uptr<GoogleReader> dataReader;
+			if(content)
+			{
+				// Content has been consumed by previous attempt
+				if(!firstAttempt && !content->rewind())
+					G2FExceptionBuilder("GoogleFS: Fail to update data").throwIt(lastError);
+				dataReader=std::make_unique<GoogleReader>(content);
+			}
+			firstAttempt=false;
+
+			// Takes ownership about dataReader
+			uptr<g_drv::FilesResource_UpdateMethod> lm(new DriveScoped<g_drv::FilesResource_UpdateMethod>(DriveScope::Item,_driveId,
+																										   _service.get(),
+																										   _authCred.get(),
+																										   node.getId(),
+																										   metadata,
+																										   mediaType,
+																										   dataReader.release()));
+			lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+			lm->Execute();
+			lastError=checkHttpResponse(lm->mutable_http_request());
+			return lastError;
+		},content?RetryEngine::Media:RetryEngine::Metadata);
 		if(e.isError())
 			G2FExceptionBuilder("GoogleFS: Fail to update data").throwIt(e);
 	}
@@ -491,20 +775,325 @@ protected:
 	virtual void cloudRemove(Node &node) override
 	{
 		// TODO Implement remove to trash
-		uptr<g_drv::FilesResource_DeleteMethod> m(_service->get_files().NewDeleteMethod(
-													  _authCred.get(),
-													  node.getId()));
-		m->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
-		m->Execute();
-		const G2FError &e=checkHttpResponse(m->mutable_http_request());
+		const G2FError &e=_retry->execute([&]()
+		{
+			uptr<g_drv::FilesResource_DeleteMethod> m(new DriveScoped<g_drv::FilesResource_DeleteMethod>(DriveScope::Item,_driveId,
+																										 _service.get(),
+																										 _authCred.get(),
+																										 node.getId()));
+			m->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+			m->Execute();
+			return checkHttpResponse(m->mutable_http_request());
+		});
 		if(e.isError())
 			G2FExceptionBuilder("GoogleFS: Fail to remove node id '%1'").arg(node.getId()).throwIt(e);
 	}
 
+	virtual bool isSameCloud(AbstractFileSystem &other) override
+	{
+		// drives of one account are served with the same credential
+		GoogleFileSystem *g=dynamic_cast<GoogleFileSystem*>(&other);
+		return g && g->_authCred==_authCred;
+	}
+
+	virtual bool cloudCopy(Node &source,Node &dest) override
+	{
+		// copy between My Drive and shared drive is allowed only with support of all drives
+		const std::string &driveId=_driveId.empty() ? static_cast<GoogleFileSystem*>(source.getTree())->_driveId : _driveId;
+		Json::Value jStorage;
+		g_drv::File f(&jStorage);
+		f.set_title(dest.getName().string());
+
+		Json::Value jRefStorage;
+		g_drv::ParentReference pref(&jRefStorage);
+		pref.set_id(_cloudId(dest.getParent()->getId()));
+
+		Json::Value jParentsStorage;
+		g_cli::JsonCppArray<g_drv::ParentReference> parents(&jParentsStorage);
+		parents.set(0,pref);
+		(*f.MutableStorage())["parents"]=*parents.MutableStorage();
+
+		uptr<g_drv::File> file;
+		const G2FError &e=_retry->execute([&]()
+		{
+			uptr<g_drv::FilesResource_CopyMethod> lm(new DriveScoped<g_drv::FilesResource_CopyMethod>(DriveScope::Item,driveId,
+																									   _service.get(),_authCred.get(),source.getId(),&f));
+			lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+			lm->set_fields(FILE_RESOURCE_FIELD);
+			file.reset(g_drv::File::New());
+
+			const g_utl::Status& s=lm->ExecuteAndParseResponse(file.get());
+			return checkHttpResponse(lm->mutable_http_request());
+		});
+		if(e)
+			G2FExceptionBuilder("GoogleFS: fail to copy node id '%1'").arg(source.getId()).throwIt(e);
+
+		fillNode(*file,dest);
+		return true;
+	}
+
+	virtual bool cloudFetchAll(Changes &all) override
+	{
+		// Listing is split by modification date to be executed in parallel
+		const time_t from=1136073600; // 2006-01-01, nothing can be older
+		const time_t to=time(nullptr);
+		const size_t parts=std::max<size_t>(_partitions,1);
+		const time_t step=std::max<time_t>((to-from)/parts,1);
+
+		std::vector<Changes> results(parts);
+		std::vector<std::exception_ptr> errors(parts);
+		std::vector<std::thread> threads;
+		for(size_t i=0;i<parts;++i)
+		{
+			std::string q="trashed=false";
+			if(i>0)
+				q+=" and modifiedDate >= '"+rfc3339(from+step*i)+"'";
+			if(i+1<parts)
+				q+=" and modifiedDate < '"+rfc3339(from+step*(i+1))+"'";
+			threads.emplace_back([this,q,i,&results,&errors]()
+			{
+				try
+				{
+					_listFiles(q,results[i]);
+				}
+				catch(...)
+				{
+					errors[i]=std::current_exception();
+				}
+			});
+		}
+		for(std::thread &t : threads)
+			t.join();
+		for(std::exception_ptr &e : errors)
+			if(e)
+				std::rethrow_exception(e);
+
+		// File modified while listing is running could be listed by two partitions, the newer state is kept
+		std::unordered_map<std::string,size_t> byId;
+		for(Changes &part : results)
+		{
+			for(Change &c : part)
+			{
+				auto ins=byId.emplace(c.id,all.size());
+				if(ins.second)
+				{
+					all.push_back(std::move(c));
+					continue;
+				}
+				Change &known=all[ins.first->second];
+				const timespec &was=known.meta->getTime(ModificationTime);
+				const timespec &now=c.meta->getTime(ModificationTime);
+				if(std::tie(now.tv_sec,now.tv_nsec)>std::tie(was.tv_sec,was.tv_nsec))
+					known=std::move(c);
+			}
+		}
+		return true;
+	}
+
+	virtual bool cloudFetchChanges(std::string &token,Changes &changes) override
+	{
+		if(token.empty() && !_driveId.empty())
+		{
+			// about resource knows only changes of My Drive
+			uptr<g_drv::ChangeList> data;
+			const G2FError &e=_retry->execute([&]()
+			{
+				uptr<g_drv::ChangesResource_ListMethod> lm(new DriveScoped<g_drv::ChangesResource_ListMethod>(DriveScope::Changes,_driveId,
+																											   _service.get(),_authCred.get()));
+				lm->set_max_results(1);
+				lm->set_fields("largestChangeId");
+				lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+				data.reset(g_drv::ChangeList::New());
+				const g_utl::Status& s=lm->ExecuteAndParseResponse(data.get());
+				return checkHttpResponse(lm->http_request());
+			});
+			if(e)
+				G2FExceptionBuilder("GoogleFS: fail to get the last change id of shared drive").throwIt(e);
+
+			token=std::to_string(json2int64(data->Storage()["largestChangeId"])+1);
+			return true;
+		}
+		if(token.empty())
+		{
+			uptr<g_drv::About> about;
+			const G2FError &e=_retry->execute([&]()
+			{
+				uptr<g_drv::AboutResource_GetMethod> m(_service->get_about().NewGetMethod(_authCred.get()));
+				m->set_fields("largestChangeId");
+				m->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+				about.reset(g_drv::About::New());
+				const g_utl::Status& s=m->ExecuteAndParseResponse(about.get());
+				return checkHttpResponse(m->http_request());
+			});
+			if(e)
+				G2FExceptionBuilder("GoogleFS: fail to get the last change id").throwIt(e);
+
+			const char n[]="largestChangeId";
+			const Json::Value *largest=about->Storage().find(G2F_STRPAIR(n));
+			token=std::to_string((largest ? json2int64(*largest) : 0)+1);
+			return true;
+		}
+
+		int64_t largestId=0;
+		std::string pageToken;
+		do
+		{
+			uptr<g_drv::ChangeList> data;
+			const G2FError &e=_retry->execute([&]()
+			{
+				uptr<g_drv::ChangesResource_ListMethod> lm(new DriveScoped<g_drv::ChangesResource_ListMethod>(DriveScope::Changes,_driveId,
+																											   _service.get(),_authCred.get()));
+				lm->set_start_change_id(std::stoll(token));
+				lm->set_include_deleted(true);
+				lm->set_max_results(1000);
+				if(!pageToken.empty())
+					lm->set_page_token(pageToken);
+				lm->set_fields("nextPageToken,largestChangeId,items(fileId,deleted,file("+FILE_RESOURCE_FIELD+",parents(id),labels(trashed)))");
+				lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+				data.reset(g_drv::ChangeList::New());
+				const g_utl::Status& s=lm->ExecuteAndParseResponse(data.get());
+				return checkHttpResponse(lm->http_request());
+			});
+			if(e)
+				G2FExceptionBuilder("GoogleFS: fail to get changes").throwIt(e);
+
+			const Json::Value &storage=data->Storage();
+			const Json::Value &items=storage["items"];
+			for(Json::ArrayIndex i=0;i<items.size();++i)
+			{
+				const Json::Value &item=items[i];
+				Change c;
+				c.id=item.get("fileId","").asString();
+				const Json::Value &file=item["file"];
+				c.removed=item.get("deleted",false).asBool() || file["labels"].get("trashed",false).asBool();
+				if(!c.removed && file.isObject())
+					_parseFile(file,c);
+				changes.push_back(std::move(c));
+			}
+			largestId=std::max(largestId,json2int64(storage["largestChangeId"]));
+			pageToken=storage.get("nextPageToken","").asString();
+		}
+		while(!pageToken.empty());
+
+		if(largestId)
+			token=std::to_string(largestId+1);
+		return true;
+	}
+
+	virtual std::string cloudExportFormat(const Node &node) override
+	{
+		std::string kind;
+		{
+			std::lock_guard<std::mutex> lock(_docKindsM);
+			auto it=_docKinds.find(node.getIdRef().to_string());
+			if(it!=_docKinds.end())
+				kind=it->second;
+		}
+		if(kind.empty() || !_conf)
+			return std::string();
+		// format is read on every use, so changed property takes effect at once
+		return getPropertyAs<std::string>(*_conf,"export_gdoc_"+kind,"");
+	}
+
+public:
+	void setBootstrapPartitions(size_t partitions)
+	{
+		_partitions=partitions;
+	}
+
+	// Source of export formats
+	void setConfiguration(const IConfigurationPtr &conf)
+	{
+		_conf=conf;
+	}
+
+	// Tree of shared drive instead of My Drive
+	void setDriveId(const std::string &driveId)
+	{
+		_driveId=driveId;
+	}
+
 private:
+	// Root alias of shared drive is the drive id
+	std::string _cloudId(const std::string &id) const
+	{
+		return id==ID_ROOT && !_driveId.empty() ? _driveId : id;
+	}
+
+	void _listFiles(const std::string &q,Changes &ret)
+	{
+		std::string pageToken;
+		do
+		{
+			uptr<g_drv::FileList> data;
+			const G2FError &e=_retry->execute([&]()
+			{
+				uptr<g_drv::FilesResource_ListMethod> lm(new DriveScoped<g_drv::FilesResource_ListMethod>(DriveScope::Listing,_driveId,
+																									   _service.get(),_authCred.get()));
+				lm->set_q(q);
+				lm->set_max_results(1000);
+				if(!pageToken.empty())
+					lm->set_page_token(pageToken);
+				lm->set_fields("nextPageToken,items("+FILE_RESOURCE_FIELD+",parents(id))");
+				lm->mutable_http_request()->mutable_options()->set_timeout_ms(_timeout);
+				data.reset(g_drv::FileList::New());
+				const g_utl::Status& s=lm->ExecuteAndParseResponse(data.get());
+				return checkHttpResponse(lm->http_request());
+			});
+			if(e)
+				G2FExceptionBuilder("GoogleFS: Error listing files").throwIt(e);
+
+			const Json::Value &items=data->Storage()["items"];
+			for(Json::ArrayIndex i=0;i<items.size();++i)
+			{
+				Change c;
+				_parseFile(items[i],c);
+				ret.push_back(std::move(c));
+			}
+			pageToken=data->Storage().get("nextPageToken","").asString();
+		}
+		while(!pageToken.empty());
+	}
+
+	void _parseFile(const Json::Value &item,Change &c)
+	{
+		Json::Value storage(item);
+		g_drv::File file(&storage);
+		c.meta.reset(new Node(this,nullptr));
+		fillNode(file,*c.meta);
+		c.id=c.meta->getId();
+		const Json::Value &parents=item["parents"];
+		if(parents.isArray() && parents.size())
+			c.parentId=parents[0u].get("id","").asString();
+	}
+
+	static int64_t json2int64(const Json::Value &v)
+	{
+		// int64 comes as string in Drive API
+		if(v.isString())
+			return std::stoll(v.asString());
+		return v.isNumeric() ? v.asInt64() : 0;
+	}
+
+	static std::string rfc3339(time_t t)
+	{
+		char buf[32];
+		struct tm tm;
+		strftime(buf,sizeof(buf),"%Y-%m-%dT%H:%M:%S",gmtime_r(&t,&tm));
+		return buf;
+	}
+
 	sptr<g_drv::DriveService> _service;
 	OAuth2CredentialPtr _authCred;
+	RetryEnginePtr _retry;
 	int64_t _timeout=60000;
+	size_t _partitions=1;
+	IConfigurationPtr _conf;
+	// Empty for My Drive
+	std::string _driveId;
+	// Kind of GDoc by id (it defines format of export)
+	std::mutex _docKindsM;
+	std::unordered_map<std::string,std::string> _docKinds;
 };
 G2F_DECLARE_PTR(GoogleFileSystem);
 
@@ -690,7 +1279,9 @@ public:
 	GoogleSessionConfiguration(const IPathManagerPtr &parentPM,const std::string &accName)
 	{
 		_pm=createNextLevelWrapperPathManager(parentPM,accName);
-		_props=std::make_shared<GoogleProviderSessionProperties>(_pm->getDir(IPathManager::CONFIG),accName);
+		_runtime=std::make_shared<RuntimePropertiesList>(accName);
+		_props=createChainedPropertiesList(std::make_shared<GoogleProviderSessionProperties>(_pm->getDir(IPathManager::CONFIG),accName),
+										   _runtime);
 	}
 
 	// IConfiguration interface
@@ -699,6 +1290,12 @@ public:
 	{
 		return _pm;
 	}
+
+	const RuntimePropertiesListPtr &getRuntimeProperties()
+	{
+		return _runtime;
+	}
+
 protected:
 	virtual const IPropertiesListPtr& getPL() override
 	{
@@ -707,8 +1304,57 @@ protected:
 
 private:
 	IPropertiesListPtr _props;
+	RuntimePropertiesListPtr _runtime;
 	IPathManagerPtr _pm;
 };
+G2F_DECLARE_PTR(GoogleSessionConfiguration);
+
+
+
+
+
+/**
+ * @brief Resources shared by sessions of all accounts served by process
+ *
+ * Drive API requests carry credentials of account, so one service (and
+ * its connections) serves every account with the same API root URL.
+ *
+ *****************************************************/
+class GoogleSharedResources
+{
+public:
+	GoogleSharedResources(const sptr<g_cli::HttpTransportLayerConfig> &conf,IConfiguration &providerConf)
+		: fs(AbstractFileSystem::SharedResources::create(providerConf)),
+		  warmPool(AbstractFileSystem::createBackgroundPool(providerConf,getPropertyAs<size_t>(providerConf,"warm_up_threads",1),true)),
+		  _transportFactory(conf)
+	{}
+
+	sptr<g_drv::DriveService> getService(const std::string &rootUrl)
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		sptr<g_drv::DriveService> &ret=_services[rootUrl];
+		if(!ret)
+		{
+			ret=std::make_shared<g_drv::DriveService>(_transportFactory.createTransport());
+			// allows to run against local stand-in of Drive API
+			if(!rootUrl.empty())
+			{
+				std::string servicePath=ret->service_path().as_string();
+				ret->ChangeServiceUrl(rootUrl,servicePath);
+			}
+		}
+		return ret;
+	}
+
+	const AbstractFileSystem::SharedResources fs;
+	const WorkerPoolPtr warmPool;
+
+private:
+	HttpTransportFactory _transportFactory;
+	std::mutex _m;
+	std::map<std::string,sptr<g_drv::DriveService>> _services;
+};
+G2F_DECLARE_PTR(GoogleSharedResources);
 
 
 
@@ -722,15 +1368,36 @@ class GoogleProviderSession : public IProviderSession
 {
 public:
 
-	GoogleProviderSession(const std::string &accId,sptr<g_cli::HttpTransportLayerConfig> conf,IProvider* parent)
+	GoogleProviderSession(const std::string &accId,sptr<g_cli::HttpTransportLayerConfig> conf,IProvider* parent,const GoogleSharedResourcesPtr &shared)
 		: _accId(accId),
 		  _transportFactory(conf),
-		  _parent(parent)
+		  _parent(parent),
+		  _shared(shared)
 	{
-		_service=std::make_shared<g_drv::DriveService>(_transportFactory.createTransport());
-
-		IConfigurationPtr current=std::make_shared<GoogleSessionConfiguration>(parent->getConfiguration()->getPaths(),_accId);
+		GoogleSessionConfigurationPtr current=std::make_shared<GoogleSessionConfiguration>(parent->getConfiguration()->getPaths(),_accId);
 		_conf=std::make_shared<ChainedConfiguration>(parent->getConfiguration(),current);
+
+		std::string rootUrl=getPropertyAs<std::string>(*_conf,"api_root_url","");
+		if(!rootUrl.empty() && rootUrl.back()!='/')
+			rootUrl+='/';
+		_service=_shared->getService(rootUrl);
+
+		_retry=std::make_shared<RetryEngine>();
+		size_t tries=getPropertyAs<size_t>(*_conf,"retry_tries",0);
+		size_t maxDelay=getPropertyAs<size_t>(*_conf,"retry_max_delay",0)*1000;
+		_retry->setPolicy(RetryEngine::Transient,{tries,500,maxDelay});
+		_retry->setPolicy(RetryEngine::RateLimit,{tries,1000,maxDelay});
+
+		size_t burst=getPropertyAs<size_t>(*_conf,"request_burst",1);
+		_retry->setLimiter(RetryEngine::Metadata,std::make_shared<AdaptiveLimiter>(getPropertyAs<double>(*_conf,"meta_request_rate",0),
+																				  getPropertyAs<size_t>(*_conf,"meta_request_concurrency",0),
+																				  burst));
+		_retry->setLimiter(RetryEngine::Media,std::make_shared<AdaptiveLimiter>(getPropertyAs<double>(*_conf,"media_request_rate",0),
+																			   getPropertyAs<size_t>(*_conf,"media_request_concurrency",0),
+																			   burst));
+		exposeLimiter(*current->getRuntimeProperties(),"meta",_retry->getLimiter(RetryEngine::Metadata));
+		exposeLimiter(*current->getRuntimeProperties(),"media",_retry->getLimiter(RetryEngine::Media));
+		exposeCache(*current->getRuntimeProperties());
 	}
 
 	// IProviderSession interface
@@ -739,14 +1406,108 @@ public:
 	{
 		if(!_fs)
 		{
-			_fs=std::make_shared<GoogleFileSystem>(
-						std::make_shared<ContentManager>(_conf->getPaths()->getDir(IPathManager::DATA)),
-						_service,
-						getAuthCred());
+			// Content of all drives of account is kept in the same cache
+			ContentManagerPtr cm=std::make_shared<ContentManager>(_conf->getPaths()->getDir(IPathManager::DATA));
+			_fs=createDriveFileSystem(cm,std::string());
+			_fs->setPinnedPaths(loadPinnedPaths());
+			_changeSync=std::make_shared<ChangeSync>(*_fs,getPropertyAs<size_t>(*_conf,"change_sync_interval",0));
+
+			_warmer=std::make_shared<CacheWarmer>(*_fs,_shared->warmPool,getPropertyAs<size_t>(*_conf,"warm_up_interval",0)*60);
+			_warmer->setGlobs(getWarmUpGlobs());
+
+			const fs::path &drivesDir=getPropertyAs<std::string>(*_conf,"shared_drives_dir","");
+			if(!drivesDir.empty())
+				mountSharedDrives(cm,drivesDir);
 		}
+		if(_joined)
+			return _joined;
 		return _fs;
 	}
 
+	GoogleFileSystemPtr createDriveFileSystem(const ContentManagerPtr &cm,const std::string &driveId)
+	{
+		GoogleFileSystemPtr ret=std::make_shared<GoogleFileSystem>(cm,_service,getAuthCred(),_retry);
+		ret->setDriveId(driveId);
+		ret->configureCache(*_conf,_shared->fs);
+		ret->setConfiguration(_conf);
+		ret->setBootstrapPartitions(getPropertyAs<size_t>(*_conf,"bootstrap_partitions",1));
+		if(getPropertyAs<bool>(*_conf,"bootstrap",false))
+			ret->bootstrap();
+		return ret;
+	}
+
+	void mountSharedDrives(const ContentManagerPtr &cm,const fs::path &drivesDir)
+	{
+		std::vector<std::pair<std::string,std::string>> drives;
+		try
+		{
+			drives=listSharedDrives();
+		}
+		catch(const G2FException &e)
+		{
+			// My Drive is still usable
+			std::cerr << e.what() << std::endl;
+			return;
+		}
+		if(drives.empty())
+			return;
+
+		JoinedFileSystemFactory jfsf(S_IRWXU|S_IRGRP|S_IXGRP);
+		jfsf.mount(ROOT_PATH,_fs,S_IRWXU|S_IRGRP|S_IXGRP);
+		std::set<std::string> names;
+		for(const auto &d : drives)
+		{
+			std::string name=d.second;
+			boost::replace_all(name,"/","_");
+			if(name.empty() || !names.insert(name).second)
+				name+=" ("+d.first+")";
+			names.insert(name);
+
+			GoogleFileSystemPtr driveFS=createDriveFileSystem(cm,d.first);
+			_driveSyncs.push_back(std::make_shared<ChangeSync>(*driveFS,getPropertyAs<size_t>(*_conf,"change_sync_interval",0)));
+			_drives.push_back(driveFS);
+			jfsf.mount(ROOT_PATH/drivesDir.relative_path()/name,driveFS,S_IRWXU|S_IRGRP|S_IXGRP);
+		}
+		_joined=jfsf.build();
+	}
+
+	// Pairs of id and name of shared drives available to account
+	std::vector<std::pair<std::string,std::string>> listSharedDrives()
+	{
+		std::vector<std::pair<std::string,std::string>> ret;
+		// mount waits for the listing, it's bound by time budget of file operation (0 - transport default)
+		const size_t timeout=getPropertyAs<size_t>(*_conf,"op_deadline",60)*1000;
+		std::string pageToken;
+		do
+		{
+			Json::Value data;
+			const G2FError &e=_retry->execute([&]()
+			{
+				uptr<DrivesListMethod> m(new DrivesListMethod(_service.get(),getAuthCred().get(),pageToken));
+				if(timeout)
+					m->mutable_http_request()->mutable_options()->set_timeout_ms(timeout);
+				m->Execute();
+				G2FError err=checkHttpResponse(m->http_request());
+				if(err)
+					return err;
+				std::string body;
+				m->http_request()->response()->GetBodyString(&body);
+				if(!Json::Reader().parse(body,data))
+					err=G2FErrorCodes::InternalError;
+				return err;
+			});
+			if(e)
+				G2FExceptionBuilder("GoogleFS: fail to list shared drives").throwIt(e);
+
+			const Json::Value &items=data["items"];
+			for(Json::ArrayIndex i=0;i<items.size();++i)
+				ret.emplace_back(items[i].get("id","").asString(),items[i].get("name","").asString());
+			pageToken=data.get("nextPageToken","").asString();
+		}
+		while(!pageToken.empty());
+		return ret;
+	}
+
 	virtual IOAuth2ProcessPtr createOAuth2Process() override
 	{
 		return std::make_shared<GoogleOAuth2>(_transportFactory,_accId,getSecretFile(),getCredentialHomeDir());
@@ -790,14 +1551,116 @@ public:
 		return confDir/"auth.info";
 	}
 
+	static void exposeLimiter(RuntimePropertiesList &rpl,const std::string &prefix,const AdaptiveLimiterPtr &limiter)
+	{
+		rpl.add(prefix+"_current_rate",IPropertyType::STRING,"Current adapted rate of "+prefix+" requests (requests/sec).",
+				[limiter](){ return (boost::format("%.2f") % limiter->getRate()).str(); });
+		rpl.add(prefix+"_current_concurrency",IPropertyType::UINT,"Current adapted number of simultaneous "+prefix+" requests.",
+				[limiter](){ return std::to_string(limiter->getConcurrency()); });
+		rpl.add(prefix+"_active_requests",IPropertyType::UINT,"Number of "+prefix+" requests in progress.",
+				[limiter](){ return std::to_string(limiter->getActive()); });
+		rpl.add(prefix+"_throttled_requests",IPropertyType::UINT,"Number of "+prefix+" requests rejected by quota.",
+				[limiter](){ return std::to_string(limiter->getThrottledCount()); });
+	}
+
+	void exposeCache(RuntimePropertiesList &rpl)
+	{
+		rpl.add("cache_pinned_paths",IPropertyType::STRING,"Paths (separated by ';') which cached content is kept offline.",
+				[this]()
+				{
+					getFileSystem();
+					std::vector<std::string> paths;
+					for(const fs::path &p : _fs->getPinnedPaths())
+						paths.push_back(p.string());
+					return boost::join(paths,";");
+				},
+				[this](const std::string &value)
+				{
+					std::vector<std::string> items;
+					std::vector<fs::path> paths;
+					boost::split(items,value,boost::is_any_of(";\n"));
+					for(std::string &i : items)
+					{
+						boost::trim(i);
+						if(i.empty())
+							continue;
+						if(i.front()!='/')
+							return G2FError(EINVAL,err::system_category());
+						paths.push_back(i);
+					}
+					getFileSystem();
+					_fs->setPinnedPaths(paths);
+					savePinnedPaths(paths);
+					return G2FError();
+				});
+		rpl.add("warm_up",IPropertyType::STRING,"Progress of cache warming. Write anything to start warming of 'warm_up_paths'.",
+				[this](){ getFileSystem(); return _warmer->getProgress(); },
+				[this](const std::string&)
+				{
+					getFileSystem();
+					_warmer->setGlobs(getWarmUpGlobs());
+					if(!_warmer->start())
+						return G2FError(EBUSY,err::system_category());
+					return G2FError();
+				});
+		rpl.add("cache_used_size",IPropertyType::UINT,"Size of cached content (Megabytes).",
+				[this](){ getFileSystem(); return std::to_string(_fs->getContentManager().getCachedBytes()/(1024*1024)); });
+		rpl.add("cache_used_files",IPropertyType::UINT,"Number of files in cache.",
+				[this](){ getFileSystem(); return std::to_string(_fs->getContentManager().getCachedFiles()); });
+	}
+
+	std::vector<std::string> getWarmUpGlobs()
+	{
+		std::vector<std::string> ret;
+		const std::string &globs=getPropertyAs<std::string>(*_conf,"warm_up_paths","");
+		boost::split(ret,globs,boost::is_any_of(";"));
+		for(std::string &g : ret)
+			boost::trim(g);
+		ret.erase(std::remove(ret.begin(),ret.end(),std::string()),ret.end());
+		return ret;
+	}
+
+	fs::path getPinnedPathsFile()
+	{
+		return getConfiguration()->getPaths()->getDir(IPathManager::CONFIG)/"pinned_paths";
+	}
+
+	std::vector<fs::path> loadPinnedPaths()
+	{
+		std::vector<fs::path> ret;
+		fs::ifstream in(getPinnedPathsFile());
+		std::string line;
+		while(std::getline(in,line))
+		{
+			if(!line.empty())
+				ret.push_back(line);
+		}
+		return ret;
+	}
+
+	void savePinnedPaths(const std::vector<fs::path> &paths)
+	{
+		fs::ofstream out(getPinnedPathsFile(),std::ios::trunc);
+		for(const fs::path &p : paths)
+			out << p.string() << std::endl;
+	}
+
 private:
 	std::string _accId;
 	HttpTransportFactory _transportFactory;
 	sptr<g_drv::DriveService> _service;
 	OAuth2CredentialPtr _authCred;
+	RetryEnginePtr _retry;
 	IProvider *_parent=nullptr;
 	IConfigurationPtr _conf;
+	GoogleSharedResourcesPtr _shared;
 	GoogleFileSystemPtr _fs;
+	ChangeSyncPtr _changeSync;
+	CacheWarmerPtr _warmer;
+	// Shared drives mounted beside My Drive
+	std::vector<GoogleFileSystemPtr> _drives;
+	std::vector<ChangeSyncPtr> _driveSyncs;
+	IFileSystemPtr _joined;
 
 };
 
@@ -820,8 +1683,22 @@ const AbstractStaticInitPropertiesList::PropDefi propsDefi[]=
 	"export_gdoc_spreadsheets",		IPropertyType::ENUM,	"gdds",		"csv",				true,	"Format to export GDoc Spreadsheets.",
 	"export_gdoc_drawings",			IPropertyType::ENUM,	"gddd",		"jpeg",				true,	"Format to export GDoc Drawings.",
 	"export_gdoc_presentations",	IPropertyType::ENUM,	"gddp",		"plain_text",		true,	"Format to export GDoc Presentations.",
+	"export_size_estimate",			IPropertyType::UINT,	0,			"1024",				false,	"Size reported for GDoc file before its first export (Kilobytes).",
 	"use-ssl-verify",				IPropertyType::BOOL,	0,			"true",				false,	"Google servers certificate's checking will be disabled.",
-	"ssl-ca-path",					IPropertyType::PATH,	0,			"",					false,	"path to the SSL certificate authority validation data."
+	"ssl-ca-path",					IPropertyType::PATH,	0,			"",					false,	"path to the SSL certificate authority validation data.",
+	"api_root_url",					IPropertyType::STRING,	0,			"",					false,	"Root URL of Google Drive API server (empty - default Google server).",
+	// Drive quota is 1000 requests per 100 seconds per user. Limits are adapted to quota errors at runtime
+	"meta_request_rate",			IPropertyType::UINT,	0,			"10",				false,	"Max rate of metadata requests to Google Drive (requests/sec, 0 - unlimited).",
+	"meta_request_concurrency",		IPropertyType::UINT,	0,			"8",				false,	"Max number of simultaneous metadata requests to Google Drive (0 - unlimited).",
+	"media_request_rate",			IPropertyType::UINT,	0,			"5",				false,	"Max rate of content requests to Google Drive (requests/sec, 0 - unlimited).",
+	"media_request_concurrency",	IPropertyType::UINT,	0,			"4",				false,	"Max number of simultaneous content requests to Google Drive (0 - unlimited).",
+	"request_burst",				IPropertyType::UINT,	0,			"20",				false,	"Max number of requests to Google Drive sent at once over request rate.",
+	"retry_tries",					IPropertyType::UINT,	0,			"6",				false,	"Max number of retries of failed request to Google Drive.",
+	"retry_max_delay",				IPropertyType::UINT,	0,			"32",				false,	"Max delay between retries of failed request to Google Drive (seconds).",
+	"bootstrap",					IPropertyType::BOOL,	0,			"false",			false,	"Load metadata of whole drive at mount instead of directory by directory.",
+	"bootstrap_partitions",			IPropertyType::UINT,	0,			"8",				false,	"Number of parallel listings of drive at bootstrap.",
+	"change_sync_interval",			IPropertyType::UINT,	0,			"60",				false,	"Interval of polling changes made on Google Drive (seconds, 0 - disabled).",
+	"shared_drives_dir",			IPropertyType::PATH,	0,			"/Shared drives",	false,	"Directory where shared drives are mounted (empty - shared drives are hidden)."
 };
 
 const AbstractStaticInitPropertiesList::EnumDefi enumDefi[]=
@@ -958,7 +1835,13 @@ public:
 
 	virtual IProviderSessionPtr createSession(const std::string &accountId,const PropList &props) override
 	{
-		return std::make_shared<GoogleProviderSession>(accountId,transportConfig(props),this);
+		const sptr<g_cli::HttpTransportLayerConfig> &transport=transportConfig(props);
+		{
+			std::lock_guard<std::mutex> lock(_m);
+			if(!_shared)
+				_shared=std::make_shared<GoogleSharedResources>(transport,*_conf);
+		}
+		return std::make_shared<GoogleProviderSession>(accountId,transport,this,_shared);
 	}
 
 	virtual ISupportedConversionPtr getSupportedConversion() override
@@ -1000,6 +1883,9 @@ public:
 
 private:
 	IConfigurationPtr _conf;
+	// created by the first session (transport options come with session)
+	std::mutex _m;
+	GoogleSharedResourcesPtr _shared;
 };
 
 
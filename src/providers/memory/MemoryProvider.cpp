@@ -0,0 +1,396 @@
+#include "MemoryProvider.h"
+#include "providers/ProvidersRegistry.h"
+#include "control/paths/PathManager.h"
+#include "fs/AbstractFileSystem.h"
+#include "error/G2FException.h"
+#include <mutex>
+#include <unordered_map>
+#include <boost/algorithm/string.hpp>
+
+namespace
+{
+
+/**
+ * @brief Reader of content is kept in memory
+ *
+ *****************************************************/
+class BlobReader : public ContentManager::IReader
+{
+public:
+	BlobReader(const sptr<const std::string> &data)
+		: _data(data)
+	{}
+
+	// IReader interface
+public:
+	virtual bool done() override
+	{
+		return _offset>=_data->size();
+	}
+
+	virtual int64_t read(char *buffer, int64_t bufSize) override
+	{
+		size_t len=std::min<size_t>(bufSize,_data->size()-_offset);
+		memcpy(buffer,_data->data()+_offset,len);
+		_offset+=len;
+		return len;
+	}
+
+	virtual G2FError error() override
+	{
+		return G2FError();
+	}
+
+	virtual bool rewind() override
+	{
+		_offset=0;
+		return true;
+	}
+
+private:
+	sptr<const std::string> _data;
+	size_t _offset=0;
+};
+
+
+
+
+
+/**
+ * @brief File system which "cloud" lives in process memory
+ *
+ * Cloud hooks have no latency, so the file system allows to measure
+ * overhead of FUSE and AbstractFileSystem layers apart from network.
+ *
+ *****************************************************/
+class MemoryFileSystem : public AbstractFileSystem
+{
+	struct Meta
+	{
+		std::string parentId;
+		fs::path name;
+		INode::NodeType type=INode::NodeType::Directory;
+		timespec modified={0,0};
+		sptr<const std::string> content=std::make_shared<std::string>();
+		std::vector<std::string> children;
+	};
+
+public:
+	MemoryFileSystem(const ContentManagerPtr &cm)
+		: AbstractFileSystem(cm)
+	{
+		Meta &root=_store["root"];
+		root.name="/";
+		clock_gettime(CLOCK_REALTIME,&root.modified);
+	}
+
+	// AbstractFileSystem interface
+protected:
+	virtual void cloudFetchMeta(Node &dest) override
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		const Meta &m=_find(dest.getId());
+		dest.setName(m.name);
+		dest.setFileType(m.type);
+		dest.setSize(m.content->size());
+		dest.setTime(ModificationTime,m.modified);
+		dest.setTime(ChangeTime,m.modified);
+		dest.setTime(AccessTime,m.modified);
+	}
+
+	virtual std::vector<std::string> cloudFetchChildrenList(const std::string &parentId) override
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		return _find(parentId).children;
+	}
+
+	virtual void cloudCreateMeta(Node &dest) override
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		const std::string &id=std::to_string(++_lastId);
+		Meta &m=_store[id];
+		m.parentId=dest.getParent()->getId();
+		m.name=dest.getName();
+		m.type=dest.getNodeType();
+		clock_gettime(CLOCK_REALTIME,&m.modified);
+		_find(m.parentId).children.push_back(id);
+		dest.setId(id);
+	}
+
+	virtual ContentManager::IReaderUPtr cloudReadMedia(Node &node) override
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		return std::make_unique<BlobReader>(_find(node.getId()).content);
+	}
+
+	virtual void cloudUpdate(Node &node, int patchFields, const std::string &mediaType, ContentManager::IReader *content) override
+	{
+		sptr<std::string> data;
+		if(content)
+		{
+			data=std::make_shared<std::string>();
+			char buf[64*1024];
+			while(!content->done())
+			{
+				int64_t readed=content->read(buf,sizeof(buf));
+				if(readed<0)
+					break;
+				data->append(buf,readed);
+			}
+			const G2FError &e=content->error();
+			if(e.isError())
+				G2FExceptionBuilder("MemoryFS: fail to read content of '%1'").arg(node.getName()).throwIt(e);
+		}
+
+		std::lock_guard<std::mutex> lock(_mtx);
+		Meta &m=_find(node.getId());
+		if(patchFields & Node::Name)
+			m.name=node.getName();
+		if((patchFields & Node::Parent) && node.getParent())
+		{
+			const std::string &parentId=node.getParent()->getId();
+			_unlink(node.getId(),m.parentId);
+			m.parentId=parentId;
+			_find(parentId).children.push_back(node.getId());
+		}
+		if(data)
+			m.content=data;
+		clock_gettime(CLOCK_REALTIME,&m.modified);
+	}
+
+	virtual bool cloudCopy(Node &source,Node &dest) override
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		// content is immutable, so copy shares it
+		Meta copy=_find(source.getId());
+		copy.parentId=dest.getParent()->getId();
+		copy.name=dest.getName();
+		const std::string &id=std::to_string(++_lastId);
+		_store[id]=copy;
+		_find(copy.parentId).children.push_back(id);
+
+		dest.setId(id);
+		dest.setSize(copy.content->size());
+		dest.setTime(ModificationTime,copy.modified);
+		dest.setTime(ChangeTime,copy.modified);
+		return true;
+	}
+
+	virtual void cloudRemove(Node &node) override
+	{
+		std::lock_guard<std::mutex> lock(_mtx);
+		auto it=_store.find(node.getId());
+		if(it==_store.end())
+			return;
+		_unlink(it->first,it->second.parentId);
+		_store.erase(it);
+	}
+
+private:
+	Meta &_find(const std::string &id)
+	{
+		auto it=_store.find(id);
+		if(it==_store.end())
+			G2F_EXCEPTION("MemoryFS: node '%1' not found").arg(id).throwItSystem(ENOENT);
+		return it->second;
+	}
+
+	void _unlink(const std::string &id,const std::string &parentId)
+	{
+		auto parent=_store.find(parentId);
+		if(parent==_store.end())
+			return;
+		auto &ch=parent->second.children;
+		ch.erase(std::remove(ch.begin(),ch.end(),id),ch.end());
+	}
+
+	std::mutex _mtx;
+	std::unordered_map<std::string,Meta> _store;
+	size_t _lastId=0;
+};
+
+
+
+
+
+/**
+ * @brief Configuration of memory provider and it's sessions
+ *
+ * Has no own properties, only separate directories
+ *
+ *****************************************************/
+class MemoryConfiguration : public IConfiguration
+{
+public:
+	MemoryConfiguration(const IConfigurationPtr &parent,const fs::path &nextLevel)
+		: _parent(parent),
+		  _pm(createNextLevelWrapperPathManager(parent->getPaths(),nextLevel))
+	{}
+
+	// IConfiguration interface
+public:
+	virtual IPathManagerPtr getPaths() override
+	{
+		return _pm;
+	}
+	virtual boost::optional<std::string> getProperty(const std::string &name) override
+	{
+		return _parent->getProperty(name);
+	}
+	virtual G2FError setProperty(const std::string &name, const std::string &value) override
+	{
+		return _parent->setProperty(name,value);
+	}
+	virtual IPropertiesListPtr getProperiesList() override
+	{
+		return _parent->getProperiesList();
+	}
+
+private:
+	IConfigurationPtr _parent;
+	IPathManagerPtr _pm;
+};
+
+
+
+
+
+/**
+ * @brief The MemoryProviderSession class
+ *
+ *****************************************************/
+class MemoryProviderSession : public IProviderSession
+{
+public:
+	MemoryProviderSession(const std::string &accId,IProvider* parent,const AbstractFileSystem::SharedResources &shared)
+		: _parent(parent),
+		  _shared(shared)
+	{
+		_conf=std::make_shared<MemoryConfiguration>(parent->getConfiguration(),accId);
+	}
+
+	// IProviderSession interface
+public:
+	virtual IFileSystemPtr getFileSystem() override
+	{
+		if(!_fs)
+		{
+			// Content doesn't outlive the process, so cache of previous run is stale
+			const fs::path &dataDir=_conf->getPaths()->getDir(IPathManager::DATA);
+			boost::system::error_code ec;
+			for(fs::directory_iterator it(dataDir,ec),itEnd;!ec && it!=itEnd;it.increment(ec))
+				fs::remove_all(it->path(),ec);
+			auto memFS=std::make_shared<MemoryFileSystem>(std::make_shared<ContentManager>(dataDir));
+			memFS->configureCache(*_conf,_shared);
+			_fs=memFS;
+		}
+		return _fs;
+	}
+
+	virtual IOAuth2ProcessPtr createOAuth2Process() override
+	{
+		G2F_EXCEPTION("MemoryProviderSession::createOAuth2Process()").throwIt(G2FErrorCodes::NotImplemented);
+		return IOAuth2ProcessPtr();
+	}
+
+	virtual IProvider *getProvider() override
+	{
+		return _parent;
+	}
+
+	virtual bool isAuthorized() override
+	{
+		return true;
+	}
+
+	virtual IConfigurationPtr getConfiguration() override
+	{
+		return _conf;
+	}
+
+private:
+	IProvider *_parent=nullptr;
+	AbstractFileSystem::SharedResources _shared;
+	IConfigurationPtr _conf;
+	IFileSystemPtr _fs;
+};
+
+
+
+
+
+/**
+ * @brief The MemoryProvider class
+ *
+ *****************************************************/
+class MemoryProvider : public IProvider
+{
+public:
+	MemoryProvider(const IConfigurationPtr &globalConf)
+	{
+		_conf=std::make_shared<MemoryConfiguration>(globalConf,"memory");
+	}
+
+public:
+	virtual std::string getName() override
+	{
+		return "memory";
+	}
+
+	virtual int getProperties() override
+	{
+		return 0;
+	}
+
+	virtual IProviderSessionPtr createSession(const std::string &accountId,const PropList &props) override
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		if(!_shared)
+			_shared.reset(new AbstractFileSystem::SharedResources(AbstractFileSystem::SharedResources::create(*_conf)));
+		return std::make_shared<MemoryProviderSession>(accountId,this,*_shared);
+	}
+
+	virtual ISupportedConversionPtr getSupportedConversion() override
+	{
+		G2F_EXCEPTION("MemoryProvider::getSupportedConversion()").throwIt(G2FErrorCodes::NotImplemented);
+		return ISupportedConversionPtr();
+	}
+
+	virtual IConfigurationPtr getConfiguration() override
+	{
+		return _conf;
+	}
+
+private:
+	IConfigurationPtr _conf;
+	// pools and cache budget of all sessions
+	std::mutex _m;
+	uptr<AbstractFileSystem::SharedResources> _shared;
+};
+
+
+
+
+
+class MemoryProviderFactory : public IProviderFactory
+{
+	// IProviderFactory interface
+public:
+	virtual std::string getName() override
+	{
+		return "memory";
+	}
+	virtual IProviderPtr create(const IConfigurationPtr &globalConf) override
+	{
+		return createMemoryProvider(globalConf);
+	}
+};
+
+ProviderRegistrar<MemoryProviderFactory> _reg(ProvidersRegistry::getInstance());
+
+}
+
+IProviderPtr createMemoryProvider(const IConfigurationPtr &globalConf)
+{
+	return std::make_shared<MemoryProvider>(globalConf);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "providers/IProvider.h"
+
+IProviderPtr createMemoryProvider(const IConfigurationPtr &globalConf);
+
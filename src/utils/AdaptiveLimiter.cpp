@@ -0,0 +1,100 @@
+#include "AdaptiveLimiter.h"
+#include "Deadline.h"
+#include <algorithm>
+
+namespace
+{
+	const double MIN_RATE=0.1;
+	// Bound of increase of rate by one successful request (requests/sec)
+	const double MAX_RATE_STEP=1;
+}
+
+AdaptiveLimiter::AdaptiveLimiter(double maxRate, size_t maxConcurrency, size_t burst)
+	: _bucket(maxRate,burst),
+	  _maxRate(maxRate),
+	  _rate(maxRate),
+	  _maxConcurrency(maxConcurrency),
+	  _concurrency(maxConcurrency)
+{}
+
+bool AdaptiveLimiter::acquire(uint64_t &ticket)
+{
+	{
+		std::unique_lock<std::mutex> lock(_m);
+		auto allowed=[this]{ return !_concurrency || _active<_concurrency; };
+		if(Deadline::isUnlimited())
+			_cv.wait(lock,allowed);
+		else if(!_cv.wait_for(lock,std::chrono::milliseconds(Deadline::remaining()),allowed))
+			return false;
+		++_active;
+		ticket=++_ticket;
+	}
+	if(_bucket.acquire())
+		return true;
+
+	std::lock_guard<std::mutex> lock(_m);
+	--_active;
+	_cv.notify_all();
+	return false;
+}
+
+void AdaptiveLimiter::release(uint64_t ticket, Outcome outcome)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	--_active;
+	if(outcome==Throttled)
+	{
+		++_throttled;
+		// Requests sent before previous decrease report about the old limits
+		if(ticket>_lastDecrease)
+		{
+			_lastDecrease=_ticket;
+			_successes=0;
+			if(_maxRate>0)
+			{
+				_rate=std::max(_rate/2,MIN_RATE);
+				_bucket.setRate(_rate);
+			}
+			if(_maxConcurrency)
+				_concurrency=std::max<size_t>(_concurrency/2,1);
+		}
+	}
+	else if(outcome==Success)
+	{
+		if(_maxRate>0 && _rate<_maxRate)
+		{
+			_rate=std::min(_rate+std::min(1/_rate,MAX_RATE_STEP),_maxRate);
+			_bucket.setRate(_rate);
+		}
+		if(_maxConcurrency && _concurrency<_maxConcurrency && ++_successes>=_concurrency)
+		{
+			++_concurrency;
+			_successes=0;
+		}
+	}
+	_cv.notify_all();
+}
+
+double AdaptiveLimiter::getRate()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _rate;
+}
+
+size_t AdaptiveLimiter::getConcurrency()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _concurrency;
+}
+
+size_t AdaptiveLimiter::getActive()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _active;
+}
+
+uint64_t AdaptiveLimiter::getThrottledCount()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _throttled;
+}
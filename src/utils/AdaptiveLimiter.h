@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include "utils/decls.h"
+#include "TokenBucket.h"
+
+/**
+ * @brief AIMD limiter of requests rate and concurrency
+ *
+ * Limits grow additively while requests succeed (rate by ~1 request/sec
+ * each second, but by at most MAX_RATE_STEP per request, concurrency by
+ * 1 per window of successful requests) and are halved when server
+ * reports that quota is exceeded. Decrease isn't repeated for requests
+ * that were sent before the previous decrease. Requests failed for other
+ * reasons don't change limits.
+ *********************************************************************/
+class AdaptiveLimiter
+{
+public:
+	enum Outcome
+	{
+		Success,
+		Throttled,		// Quota exceeded
+		Failed			// Neither success nor quota error, limits are kept
+	};
+
+	// maxRate==0 - rate isn't limited, maxConcurrency==0 - concurrency isn't limited
+	AdaptiveLimiter(double maxRate, size_t maxConcurrency, size_t burst);
+
+	// Blocks until request can be sent, returns ticket which must be passed to release().
+	// Returns false if request can't be sent before deadline of current operation
+	bool acquire(uint64_t &ticket);
+	void release(uint64_t ticket, Outcome outcome);
+
+	double getRate();
+	size_t getConcurrency();
+	size_t getActive();
+	uint64_t getThrottledCount();
+
+private:
+	std::mutex _m;
+	std::condition_variable _cv;
+	TokenBucket _bucket;
+
+	double _maxRate;
+	double _rate;
+	size_t _maxConcurrency;
+	size_t _concurrency;
+	size_t _active=0;
+	size_t _successes=0;
+
+	uint64_t _ticket=0;
+	uint64_t _lastDecrease=0;
+	uint64_t _throttled=0;
+};
+G2F_DECLARE_PTR(AdaptiveLimiter);
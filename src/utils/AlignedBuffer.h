@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+
+
+/**
+ * @brief Heap buffer aligned to page (suitable for O_DIRECT I/O)
+ *
+ *********************************************************************/
+class AlignedBuffer
+{
+public:
+	// Default size of buffers of bulk data transfer
+	static const size_t DEFAULT_SIZE=1024*1024;
+	static const size_t ALIGNMENT=4096;
+
+	explicit AlignedBuffer(size_t size=DEFAULT_SIZE)
+		: _size(size)
+	{
+		if(posix_memalign(&_data,ALIGNMENT,size)!=0)
+			throw std::bad_alloc();
+	}
+	~AlignedBuffer()
+	{
+		free(_data);
+	}
+	AlignedBuffer(const AlignedBuffer&) =delete;
+	AlignedBuffer &operator=(const AlignedBuffer&) =delete;
+
+	char *data()
+	{
+		return static_cast<char*>(_data);
+	}
+	size_t size() const
+	{
+		return _size;
+	}
+
+private:
+	void *_data=nullptr;
+	size_t _size=0;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <boost/utility/string_ref.hpp>
+
+
+/**
+ * @brief String keeps short values inside of object
+ *
+ * Values up to Inline chars don't allocate heap memory. The last byte of
+ * storage holds count of unused inline chars (so it's terminating zero for
+ * value of maximal length) or HEAP mark for long values.
+ * sizeof(CompactString<N>)==N+1 and alignment is 1, so it packs tightly into
+ * memory consuming structures like nodes of file tree.
+ *
+ *********************************************************************/
+template<size_t Inline>
+class CompactString
+{
+	static_assert(Inline>=sizeof(char*)+sizeof(size_t) && Inline<255,"CompactString: wrong inline size");
+
+public:
+	CompactString()
+	{
+		_init(nullptr,0);
+	}
+	CompactString(const std::string &value)
+	{
+		_init(value.data(),value.size());
+	}
+	CompactString(const CompactString &that)
+	{
+		_init(that.data(),that.size());
+	}
+	CompactString(CompactString &&that) noexcept
+	{
+		memcpy(_d,that._d,sizeof(_d));
+		that._init(nullptr,0);
+	}
+	~CompactString()
+	{
+		_free();
+	}
+
+	CompactString &operator=(const CompactString &that)
+	{
+		if(this!=&that)
+		{
+			_free();
+			_init(that.data(),that.size());
+		}
+		return *this;
+	}
+	CompactString &operator=(CompactString &&that) noexcept
+	{
+		if(this!=&that)
+		{
+			_free();
+			memcpy(_d,that._d,sizeof(_d));
+			that._init(nullptr,0);
+		}
+		return *this;
+	}
+	CompactString &operator=(const std::string &value)
+	{
+		_free();
+		_init(value.data(),value.size());
+		return *this;
+	}
+
+	const char *data() const
+	{
+		return _isHeap() ? _heap().ptr : _d;
+	}
+	size_t size() const
+	{
+		return _isHeap() ? _heap().size : Inline-static_cast<unsigned char>(_d[Inline]);
+	}
+	bool empty() const
+	{
+		return size()==0;
+	}
+	std::string str() const
+	{
+		return std::string(data(),size());
+	}
+	boost::string_ref ref() const
+	{
+		return boost::string_ref(data(),size());
+	}
+
+	bool operator==(const CompactString &that) const
+	{
+		return size()==that.size() && memcmp(data(),that.data(),size())==0;
+	}
+	bool operator!=(const CompactString &that) const
+	{
+		return !(*this==that);
+	}
+
+private:
+	static const unsigned char HEAP=0xFF;
+
+	struct Heap
+	{
+		char *ptr;
+		size_t size;
+	};
+
+	bool _isHeap() const
+	{
+		return static_cast<unsigned char>(_d[Inline])==HEAP;
+	}
+	Heap _heap() const
+	{
+		Heap ret;
+		memcpy(&ret,_d,sizeof(ret));
+		return ret;
+	}
+	void _init(const char *value,size_t len)
+	{
+		if(len<=Inline)
+		{
+			if(len)
+				memcpy(_d,value,len);
+			_d[len]=0;
+			_d[Inline]=static_cast<char>(Inline-len);
+		}
+		else
+		{
+			Heap h{new char[len+1],len};
+			memcpy(h.ptr,value,len);
+			h.ptr[len]=0;
+			memcpy(_d,&h,sizeof(h));
+			_d[Inline]=static_cast<char>(HEAP);
+		}
+	}
+	void _free()
+	{
+		if(_isHeap())
+			delete[] _heap().ptr;
+	}
+
+	char _d[Inline+1];
+};
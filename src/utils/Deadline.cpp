@@ -0,0 +1,54 @@
+#include "Deadline.h"
+
+namespace
+{
+	thread_local Deadline::Clock::time_point currDeadline=Deadline::Clock::time_point::max();
+}
+
+Deadline::Scope::Scope(size_t budget)
+	: _prev(currDeadline)
+{
+	if(budget)
+	{
+		Clock::time_point tp=Clock::now()+std::chrono::milliseconds(budget);
+		if(tp<currDeadline)
+			currDeadline=tp;
+	}
+}
+
+Deadline::Scope::Scope(Clock::time_point deadline)
+	: _prev(currDeadline)
+{
+	if(deadline<currDeadline)
+		currDeadline=deadline;
+}
+
+Deadline::Scope::~Scope()
+{
+	currDeadline=_prev;
+}
+
+Deadline::Clock::time_point Deadline::current()
+{
+	return currDeadline;
+}
+
+size_t Deadline::remaining()
+{
+	if(isUnlimited())
+		return size_t(-1);
+	Clock::time_point now=Clock::now();
+	if(now>=currDeadline)
+		return 0;
+	return std::chrono::duration_cast<std::chrono::milliseconds>(currDeadline-now).count();
+}
+
+bool Deadline::isUnlimited()
+{
+	return currDeadline==Clock::time_point::max();
+}
+
+bool Deadline::allows(size_t ms)
+{
+	return remaining()>=ms;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * @brief Time budget of current operation
+ *
+ * Deadline is bound to the calling thread. Scope sets new deadline
+ * which can only shorten the enclosing one. Work passed to other
+ * threads carries deadline of its operation (see current()).
+ *********************************************************************/
+class Deadline
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	class Scope
+	{
+	public:
+		// budget in milliseconds (0 - unlimited)
+		Scope(size_t budget);
+		// deadline of other thread
+		explicit Scope(Clock::time_point deadline);
+		~Scope();
+
+		Scope(const Scope&) =delete;
+		Scope& operator=(const Scope&) =delete;
+	private:
+		Clock::time_point _prev;
+	};
+
+	// Deadline of calling thread (time_point::max() - unlimited)
+	static Clock::time_point current();
+	// Remaining time in milliseconds
+	static size_t remaining();
+	static bool isUnlimited();
+	// Is there time to wait 'ms' milliseconds
+	static bool allows(size_t ms);
+};
@@ -1,10 +1,12 @@
 #include "ExponentialBackoff.h"
 
-ExponentialBackoff::ExponentialBackoff(size_t nTry,int seed)
+ExponentialBackoff::ExponentialBackoff(size_t nTry, int seed, size_t baseTime, size_t maxTime)
 	: _gen(seed),
-	  _dist(1,1000),
+	  _dist(1,baseTime?baseTime:1),
 	  _nTry(nTry),
-	  _curr(0)
+	  _curr(0),
+	  _baseTime(baseTime),
+	  _maxTime(maxTime)
 {}
 
 bool ExponentialBackoff::end()
@@ -14,6 +16,14 @@ bool ExponentialBackoff::end()
 
 size_t ExponentialBackoff::nextTime()
 {
-	size_t ret=(1 << _curr++)*1000 + _dist(_gen);
+	size_t shift=_curr<30?_curr:30;
+	++_curr;
+	size_t ret=(size_t(1) << shift)*_baseTime + _dist(_gen);
+	if(_maxTime && ret>_maxTime)
+	{
+		// Keep jitter near the top to not synchronize clients
+		size_t jitter=_dist(_gen);
+		ret=jitter<_maxTime?_maxTime-jitter:_maxTime;
+	}
 	return ret;
 }
@@ -5,7 +5,8 @@
 class ExponentialBackoff
 {
 public:
-	ExponentialBackoff(size_t nTry, int seed=1);
+	// baseTime and maxTime are in milliseconds (maxTime==0 - without limit)
+	ExponentialBackoff(size_t nTry, int seed=1, size_t baseTime=1000, size_t maxTime=0);
 	bool end();
 	size_t nextTime();
 
@@ -15,5 +16,6 @@ private:
 
 	size_t _nTry;
 	size_t _curr;
+	size_t _baseTime;
+	size_t _maxTime;
 };
-
@@ -0,0 +1,139 @@
+#include "RetryEngine.h"
+#include "ExponentialBackoff.h"
+#include "Deadline.h"
+#include "utils/log.h"
+#include <cassert>
+#include <random>
+#include <thread>
+
+namespace
+{
+	// Seed of jitter of backoff
+	std::mt19937::result_type nextSeed()
+	{
+		thread_local std::mt19937 engine{std::random_device()()};
+		return engine();
+	}
+}
+
+RetryEngine::Slot::~Slot()
+{
+	release();
+}
+
+void RetryEngine::Slot::release(AdaptiveLimiter::Outcome outcome)
+{
+	if(_limiter)
+		_limiter->release(_ticket,outcome);
+	_limiter.reset();
+}
+
+RetryEngine::RetryEngine()
+{
+	_policies[Fatal]={0,0,0};
+	_policies[Transient]={5,500,16000};
+	_policies[RateLimit]={6,1000,32000};
+}
+
+RetryEngine &RetryEngine::setPolicy(RetryEngine::ErrorClass ec, const RetryEngine::Policy &policy)
+{
+	assert(ec<ErrorClassSize);
+	_policies[ec]=policy;
+	return *this;
+}
+
+const RetryEngine::Policy &RetryEngine::getPolicy(RetryEngine::ErrorClass ec) const
+{
+	assert(ec<ErrorClassSize);
+	return _policies[ec];
+}
+
+RetryEngine &RetryEngine::setLimiter(RetryEngine::Channel ch, const AdaptiveLimiterPtr &limiter)
+{
+	assert(ch<ChannelSize);
+	_limiters[ch]=limiter;
+	return *this;
+}
+
+const AdaptiveLimiterPtr &RetryEngine::getLimiter(RetryEngine::Channel ch) const
+{
+	assert(ch<ChannelSize);
+	return _limiters[ch];
+}
+
+G2FError RetryEngine::execute(const RetryEngine::Request &request, Channel ch, Slot *hold)
+{
+	uptr<ExponentialBackoff> backoffs[ErrorClassSize];
+	AdaptiveLimiter *limiter=_limiters[ch].get();
+	if(hold)
+		hold->release();
+
+	while(true)
+	{
+		G2FError ret;
+		ErrorClass ec;
+		uint64_t ticket=0;
+		if(limiter && !limiter->acquire(ticket))
+		{
+			G2F_LOG("Request isn't sent: limiter doesn't allow it before deadline");
+			return G2FError(HttpTimeoutError).setDetail(G2FMESSAGE("Deadline of operation is exceeded while waiting for request quota"));
+		}
+		try
+		{
+			ret=request();
+		}
+		catch(...)
+		{
+			if(limiter)
+				limiter->release(ticket,AdaptiveLimiter::Failed);
+			throw;
+		}
+		if(!ret.isError())
+		{
+			if(limiter && hold)
+			{
+				hold->_limiter=_limiters[ch];
+				hold->_ticket=ticket;
+			}
+			else if(limiter)
+				limiter->release(ticket,AdaptiveLimiter::Success);
+			return ret;
+		}
+		ec=classify(ret);
+		if(limiter)
+			limiter->release(ticket,ec==RateLimit ? AdaptiveLimiter::Throttled : AdaptiveLimiter::Failed);
+
+		const Policy &p=_policies[ec];
+		uptr<ExponentialBackoff> &eb=backoffs[ec];
+		if(!eb)
+			eb=std::make_unique<ExponentialBackoff>(p.tries,nextSeed(),p.baseDelay,p.maxDelay);
+		if(eb->end())
+			return ret;
+
+		size_t delay=eb->nextTime();
+		if(!Deadline::allows(delay))
+		{
+			G2F_LOG("Retrying is stopped by deadline, error: " << ret.message());
+			return ret;
+		}
+		G2F_LOG("Retry after " << delay << " msec, error: " << ret.message());
+		std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+	}
+}
+
+RetryEngine::ErrorClass RetryEngine::classify(const G2FError &e)
+{
+	if(e.category()!=appErrorCategory())
+		return Fatal;
+
+	switch(e.value())
+	{
+	case HttpRateLimitError:
+		return RateLimit;
+	case HttpTransportError:
+	case HttpTimeoutError:
+	case HttpServerError:
+		return Transient;
+	}
+	return Fatal;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include "utils/decls.h"
+#include "error/appError.h"
+#include "AdaptiveLimiter.h"
+
+/**
+ * @brief Executes cloud requests and retries failed ones
+ *
+ * Every attempt passes through limiter of its channel, which adapts to
+ * quota errors reported by server. Failed attempts are
+ * classified and retried with jittered exponential backoff according to
+ * policy of their class, until the policy or the deadline of current
+ * operation (see Deadline) is exhausted.
+ *********************************************************************/
+class RetryEngine
+{
+public:
+	enum ErrorClass
+	{
+		Fatal,			// Don't retry
+		Transient,		// Network failures, timeouts, 5xx
+		RateLimit,		// Quota exceeded
+
+		ErrorClassSize
+	};
+
+	enum Channel
+	{
+		Metadata,
+		Media,
+
+		ChannelSize
+	};
+
+	struct Policy
+	{
+		size_t tries;		// Max number of retries
+		size_t baseDelay;	// msec
+		size_t maxDelay;	// msec (0 - unlimited)
+	};
+
+	// Request can throw to break retrying
+	typedef std::function<G2FError()> Request;
+
+	/**
+	 * @brief Limiter slot kept after successful request
+	 *
+	 * Response body streamed after execute() stays within concurrency
+	 * limit of channel until the slot is released or destroyed.
+	 *****************************************************/
+	class Slot
+	{
+	public:
+		Slot()=default;
+		~Slot();
+		Slot(const Slot&)=delete;
+		Slot &operator=(const Slot&)=delete;
+
+		void release(AdaptiveLimiter::Outcome outcome=AdaptiveLimiter::Success);
+
+	private:
+		friend class RetryEngine;
+		AdaptiveLimiterPtr _limiter;
+		uint64_t _ticket=0;
+	};
+
+	RetryEngine();
+
+	RetryEngine &setPolicy(ErrorClass ec, const Policy &policy);
+	const Policy &getPolicy(ErrorClass ec) const;
+	// Channel without limiter isn't limited
+	RetryEngine &setLimiter(Channel ch, const AdaptiveLimiterPtr &limiter);
+	const AdaptiveLimiterPtr &getLimiter(Channel ch) const;
+
+	// If 'hold' is passed, slot of successful request is moved into it instead of release
+	G2FError execute(const Request &request, Channel ch=Metadata, Slot *hold=nullptr);
+
+	static ErrorClass classify(const G2FError &e);
+
+private:
+	Policy _policies[ErrorClassSize];
+	AdaptiveLimiterPtr _limiters[ChannelSize];
+};
+G2F_DECLARE_PTR(RetryEngine);
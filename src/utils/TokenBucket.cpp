@@ -0,0 +1,73 @@
+#include "TokenBucket.h"
+#include "Deadline.h"
+#include <thread>
+
+TokenBucket::TokenBucket(double rate, size_t burst)
+	: _rate(rate),
+	  _burst(burst?burst:1),
+	  _tokens(_burst),
+	  _last(Clock::now())
+{}
+
+bool TokenBucket::acquire()
+{
+	while(true)
+	{
+		Clock::duration wait;
+		{
+			std::lock_guard<std::mutex> lock(_m);
+			wait=_refill();
+			if(wait==Clock::duration::zero())
+			{
+				_tokens-=1;
+				return true;
+			}
+		}
+		if(!Deadline::allows(std::chrono::duration_cast<std::chrono::milliseconds>(wait).count()+1))
+			return false;
+		std::this_thread::sleep_for(wait);
+	}
+}
+
+bool TokenBucket::tryAcquire()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	if(_refill()!=Clock::duration::zero())
+		return false;
+	_tokens-=1;
+	return true;
+}
+
+void TokenBucket::setRate(double rate)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	_refill();
+	_rate=rate;
+}
+
+double TokenBucket::getRate()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _rate;
+}
+
+TokenBucket::Clock::duration TokenBucket::_refill()
+{
+	if(_rate<=0)
+	{
+		_tokens=_burst;
+		return Clock::duration::zero();
+	}
+
+	Clock::time_point now=Clock::now();
+	std::chrono::duration<double> elapsed=now-_last;
+	_last=now;
+	_tokens+=elapsed.count()*_rate;
+	if(_tokens>_burst)
+		_tokens=_burst;
+	if(_tokens>=1)
+		return Clock::duration::zero();
+
+	std::chrono::duration<double> wait((1-_tokens)/_rate);
+	return std::chrono::duration_cast<Clock::duration>(wait)+Clock::duration(1);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+/**
+ * @brief Token bucket rate limiter
+ *
+ * Bucket is refilled with 'rate' tokens per second up to 'burst'.
+ * Zero rate means unlimited bucket.
+ *********************************************************************/
+class TokenBucket
+{
+public:
+	TokenBucket(double rate, size_t burst);
+
+	// Blocks until token will be available. Returns false at once if it
+	// won't be available before deadline of current operation (see Deadline)
+	bool acquire();
+	bool tryAcquire();
+
+	void setRate(double rate);
+	double getRate();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// Must be called under lock. Returns time to wait for next token
+	Clock::duration _refill();
+
+	std::mutex _m;
+	double _rate;
+	double _burst;
+	double _tokens;
+	Clock::time_point _last;
+};
@@ -0,0 +1,156 @@
+#include "WorkerPool.h"
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace
+{
+	// glibc doesn't provide ioprio_set wrapper (see linux/ioprio.h)
+	const int IOPRIO_WHO_PROCESS=1;
+	const int IOPRIO_CLASS_IDLE=3;
+	const int IOPRIO_CLASS_SHIFT=13;
+
+	void setIdleIOPriority()
+	{
+#ifdef SYS_ioprio_set
+		// who==0 - calling thread
+		syscall(SYS_ioprio_set,IOPRIO_WHO_PROCESS,0,IOPRIO_CLASS_IDLE<<IOPRIO_CLASS_SHIFT);
+#endif
+	}
+}
+
+WorkerPool::WorkerPool(size_t threads, bool idleIO)
+{
+	if(!threads)
+		threads=1;
+	for(size_t i=0;i<threads;++i)
+		_threads.emplace_back(&WorkerPool::_run,this,idleIO);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		_stop=true;
+		_queue.clear();
+	}
+	_cv.notify_all();
+	for(std::thread &t : _threads)
+		t.join();
+}
+
+void WorkerPool::post(const Task &task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		_queue.push_back(Item{task,Deadline::current()});
+	}
+	_cv.notify_one();
+}
+
+void WorkerPool::wait()
+{
+	std::unique_lock<std::mutex> lock(_m);
+	_cvIdle.wait(lock,[this]{ return _queue.empty() && !_running; });
+}
+
+void WorkerPool::setTaskBudget(size_t budget)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	_ownBudget=true;
+	_taskBudget=budget;
+}
+
+size_t WorkerPool::getThreads() const
+{
+	return _threads.size();
+}
+
+size_t WorkerPool::getPending()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _queue.size()+_running;
+}
+
+WorkerPool::Scope::Scope(const sptr<WorkerPool> &pool)
+	: _pool(pool),
+	  _state(std::make_shared<State>())
+{}
+
+WorkerPool::Scope::~Scope()
+{
+	close();
+}
+
+void WorkerPool::Scope::post(const Task &task)
+{
+	sptr<State> state=_state;
+	_pool->post([state,task]
+	{
+		{
+			std::lock_guard<std::mutex> lock(state->m);
+			if(state->closed)
+				return;
+			++state->running;
+		}
+		try
+		{
+			task();
+		}
+		catch(...)
+		{}
+		std::lock_guard<std::mutex> lock(state->m);
+		if(!--state->running)
+			state->cv.notify_all();
+	});
+}
+
+void WorkerPool::Scope::close()
+{
+	std::unique_lock<std::mutex> lock(_state->m);
+	_state->closed=true;
+	_state->cv.wait(lock,[this]{ return !_state->running; });
+}
+
+WorkerPool &WorkerPool::Scope::getPool()
+{
+	return *_pool;
+}
+
+void WorkerPool::_run(bool idleIO)
+{
+	if(idleIO)
+		setIdleIOPriority();
+
+	std::unique_lock<std::mutex> lock(_m);
+	for(;;)
+	{
+		_cv.wait(lock,[this]{ return _stop || !_queue.empty(); });
+		if(_stop)
+			break;
+		Item item=std::move(_queue.front());
+		_queue.pop_front();
+		++_running;
+		const bool ownBudget=_ownBudget;
+		const size_t budget=_taskBudget;
+		lock.unlock();
+		try
+		{
+			if(ownBudget)
+			{
+				Deadline::Scope deadline(budget);
+				item.task();
+			}
+			else
+			{
+				Deadline::Scope deadline(item.deadline);
+				item.task();
+			}
+		}
+		catch(...)
+		{}
+		lock.lock();
+		--_running;
+		if(_queue.empty() && !_running)
+			_cvIdle.notify_all();
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "utils/decls.h"
+#include "utils/Deadline.h"
+
+/**
+ * @brief Fixed set of threads executing queued tasks
+ *
+ * Exceptions thrown by tasks are swallowed. Task runs under deadline of
+ * the thread that posted it (see Deadline), tasks of background pool run
+ * under own budget instead. Threads of pool with idle I/O priority don't
+ * compete for disk with foreground file operations.
+ *********************************************************************/
+class WorkerPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	 * @brief Tasks of one owner in pool shared by several owners
+	 *
+	 * Closing of scope (on destruction) skips its queued tasks and waits
+	 * for running ones, so tasks could refer to owner.
+	 ******************************************/
+	class Scope
+	{
+	public:
+		Scope(const sptr<WorkerPool> &pool);
+		~Scope();
+
+		void post(const Task &task);
+		void close();
+		WorkerPool &getPool();
+
+	private:
+		struct State
+		{
+			std::mutex m;
+			std::condition_variable cv;
+			size_t running=0;
+			bool closed=false;
+		};
+
+		sptr<WorkerPool> _pool;
+		sptr<State> _state;
+	};
+
+	WorkerPool(size_t threads, bool idleIO=false);
+	// Drops queued tasks and waits for running ones
+	~WorkerPool();
+
+	void post(const Task &task);
+	// Blocks until queue is empty and no task is running
+	void wait();
+
+	// Tasks outlive operations that post them (e.g. downloads, prefetch): they run under
+	// budget in milliseconds (0 - unlimited) counted from their start
+	void setTaskBudget(size_t budget);
+	size_t getThreads() const;
+	size_t getPending();
+
+private:
+	struct Item
+	{
+		Task task;
+		Deadline::Clock::time_point deadline;
+	};
+
+	void _run(bool idleIO);
+
+	std::mutex _m;
+	std::condition_variable _cv;
+	std::condition_variable _cvIdle;
+	std::deque<Item> _queue;
+	std::vector<std::thread> _threads;
+	size_t _running=0;
+	bool _stop=false;
+	bool _ownBudget=false;
+	size_t _taskBudget=0;
+};
+G2F_DECLARE_PTR(WorkerPool);
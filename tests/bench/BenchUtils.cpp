@@ -0,0 +1,86 @@
+#include "BenchUtils.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+namespace
+{
+	std::atomic<size_t> allocCount{0};
+	std::atomic<size_t> allocBytes{0};
+	std::atomic<int64_t> heapBytes{0};
+}
+
+void *operator new(size_t size)
+{
+	allocCount.fetch_add(1,std::memory_order_relaxed);
+	allocBytes.fetch_add(size,std::memory_order_relaxed);
+	if(void *p=std::malloc(size ? size : 1))
+	{
+		heapBytes.fetch_add(malloc_usable_size(p),std::memory_order_relaxed);
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+// Not inlined into containers of this file: GCC takes free() there for mismatched with operator new
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+	if(p)
+		heapBytes.fetch_sub(malloc_usable_size(p),std::memory_order_relaxed);
+	std::free(p);
+}
+
+void operator delete(void *p,size_t) noexcept
+{
+	operator delete(p);
+}
+
+namespace bench
+{
+
+size_t allocations()
+{
+	return allocCount.load(std::memory_order_relaxed);
+}
+
+size_t allocatedBytes()
+{
+	return allocBytes.load(std::memory_order_relaxed);
+}
+
+int64_t liveBytes()
+{
+	return heapBytes.load(std::memory_order_relaxed);
+}
+
+AllocCounter::AllocCounter(benchmark::State &state)
+	: _state(state),
+	  _count(allocations()),
+	  _bytes(allocatedBytes())
+{}
+
+AllocCounter::~AllocCounter()
+{
+	_state.counters["allocs"]=benchmark::Counter(allocations()-_count,benchmark::Counter::kAvgIterations);
+	_state.counters["alloc_bytes"]=benchmark::Counter(allocatedBytes()-_bytes,benchmark::Counter::kAvgIterations);
+}
+
+std::vector<std::string> populate(IFileSystem &fs,size_t dirs,size_t files)
+{
+	std::vector<std::string> ret;
+	for(size_t d=0;d<dirs;++d)
+	{
+		const fs::path &dir=fs::path("/")/("dir"+std::to_string(d));
+		fs.createNode(dir,true);
+		for(size_t f=0;f<files;++f)
+		{
+			const fs::path &file=dir/("file"+std::to_string(f));
+			fs.createNode(file,false);
+			ret.push_back(file.string());
+		}
+	}
+	return ret;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "fs/IFileSystem.h"
+
+/**
+ * @brief Helpers of micro benchmarks
+ *
+ * Global operator new of micro_bench counts allocations, AllocCounter
+ * reports their number per iteration next to time of operation.
+ *********************************************************************/
+namespace bench
+{
+	// Allocations made by process since start
+	size_t allocations();
+	size_t allocatedBytes();
+	// Heap bytes allocated by operator new and not freed yet
+	int64_t liveBytes();
+
+	// Reports allocations per iteration made between construction and destruction
+	class AllocCounter
+	{
+	public:
+		AllocCounter(benchmark::State &state);
+		~AllocCounter();
+
+	private:
+		benchmark::State &_state;
+		size_t _count;
+		size_t _bytes;
+	};
+
+	// Creates 'dirs' folders with 'files' empty files in each, returns paths of files
+	std::vector<std::string> populate(IFileSystem &fs,size_t dirs,size_t files);
+}
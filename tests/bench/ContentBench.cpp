@@ -0,0 +1,64 @@
+// Filling of content cache by download: body of FakeDrive media response is
+// streamed by ContentManager::createFile into cache file, as download of
+// AbstractFileSystem does (without provider and HTTP client of Google).
+#include "BenchUtils.h"
+#include "support/TestEnv.h"
+#include "fake/FakeDrive.h"
+#include "fake/HttpConnection.h"
+#include "fs/ContentManager.h"
+
+namespace
+{
+	class ConnectionReader : public ContentManager::IReader
+	{
+	public:
+		ConnectionReader(HttpConnection &c)
+			: _c(c)
+		{}
+
+		virtual bool done() override
+		{
+			return _readed==_c.getContentLength();
+		}
+		virtual int64_t read(char *buffer, int64_t bufSize) override
+		{
+			int64_t ret=_c.read(buffer,bufSize);
+			if(ret>0)
+				_readed+=ret;
+			return ret;
+		}
+		virtual G2FError error() override
+		{
+			return G2FError();
+		}
+
+	private:
+		HttpConnection &_c;
+		size_t _readed=0;
+	};
+}
+
+// Bytes per second of download into cache: size of file (MiB), direct I/O of cache files
+static void BM_CacheFill(benchmark::State &state)
+{
+	const size_t size=state.range(0)*1024*1024;
+	FakeDrive drive;
+	drive.start();
+	const std::string url=drive.getRootUrl()+"drive/v2/files/"+drive.addFile("root","file",std::string(size,'x'))+"?alt=media";
+
+	testenv::app();
+	testenv::TempDir dir;
+	ContentManager cm(dir.path());
+	ContentManager::IOOptions io;
+	io.directIO=state.range(1);
+	cm.setIOOptions(io);
+
+	for(auto _ : state)
+	{
+		HttpConnection c("GET",url);
+		ConnectionReader r(c);
+		cm.createFile("file",&r,size);
+	}
+	state.SetBytesProcessed(state.iterations()*size);
+}
+BENCHMARK(BM_CacheFill)->ArgNames({"MiB","direct"})->Args({1,0})->Args({64,0})->Args({64,1})->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,304 @@
+// Lookup and attribute hot paths of FUSE operations over memory file system:
+// JoinedFileSystem and AbstractFileSystem lookup, Cache, Node::fillAttr (alone and
+// from 1 to 64 threads) and, when built with libfuse, handler entry points.
+#include "BenchUtils.h"
+#include "support/TestEnv.h"
+#include "cache/Cache.h"
+#include "fs/AbstractFileSystem.h"
+#include "fs/ConfFileSystem.h"
+#include "fs/JoinedFileSystem.h"
+#include <algorithm>
+#include <random>
+#ifdef G2F_HAVE_FUSE
+#include "presentation/FuseGate.h"
+#include "presentation/handler.h"
+#include <fcntl.h>
+
+int g2f_getattr(const char *path, struct stat *statbuf);
+int g2f_open(const char *path, struct fuse_file_info *fi);
+int g2f_read(const char *path, char *buf, size_t size, off_t offset, struct fuse_file_info *fi);
+int g2f_release(const char *path, struct fuse_file_info *fi);
+
+namespace
+{
+	fuse_context benchContext;
+}
+
+// Handlers find FuseGate in context of FUSE request, outside of fuse_main it's provided here
+extern "C" fuse_context *fuse_get_context(void)
+{
+	return &benchContext;
+}
+#endif
+
+namespace
+{
+	const size_t DIRS=32;
+	const size_t FILES=32;
+	const int MODE=S_IRWXU|S_IRGRP|S_IXGRP;
+
+	// Memory account mounted at root as FuseGate does
+	struct Tree
+	{
+		IProviderSessionPtr session;
+		IFileSystemPtr memory;
+		IFileSystemPtr joined;
+		std::vector<std::string> files;
+
+		Tree()
+		{
+			session=testenv::memorySession();
+			memory=session->getFileSystem();
+			files=bench::populate(*memory,DIRS,FILES);
+
+			JoinedFileSystemFactory jfsf(MODE);
+			jfsf.mount("/",memory,MODE);
+			jfsf.mount("/.conf",createConfigurationFS(session->getConfiguration()),S_IRUSR|S_IXUSR);
+			joined=jfsf.build();
+		}
+	};
+
+	Tree &tree()
+	{
+		static Tree ret;
+		return ret;
+	}
+
+	// Paths in random order, so lookups don't hit the same cache lines
+	std::vector<std::string> shuffled()
+	{
+		std::vector<std::string> ret=tree().files;
+		std::shuffle(ret.begin(),ret.end(),std::mt19937(1));
+		return ret;
+	}
+}
+
+static void BM_JoinedGet(benchmark::State &state)
+{
+	IFileSystem &fs=*tree().joined;
+	const std::vector<std::string> &paths=shuffled();
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(fs.get(paths[i++%paths.size()]));
+}
+BENCHMARK(BM_JoinedGet);
+
+static void BM_JoinedFind(benchmark::State &state)
+{
+	IFileSystem &fs=*tree().joined;
+	const std::vector<std::string> &paths=shuffled();
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(fs.find(paths[i++%paths.size()]));
+}
+BENCHMARK(BM_JoinedFind);
+
+static void BM_AbstractGet(benchmark::State &state)
+{
+	IFileSystem &fs=*tree().memory;
+	const std::vector<std::string> &paths=shuffled();
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(fs.get(paths[i++%paths.size()]));
+}
+BENCHMARK(BM_AbstractGet);
+
+static void BM_AbstractFind(benchmark::State &state)
+{
+	IFileSystem &fs=*tree().memory;
+	const std::vector<std::string> &paths=shuffled();
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(fs.find(paths[i++%paths.size()]));
+}
+BENCHMARK(BM_AbstractFind);
+
+static void BM_CacheFindByPath(benchmark::State &state)
+{
+	Cache cache;
+	const std::vector<std::string> &paths=shuffled();
+	for(const std::string &p : paths)
+	{
+		INode *n=tree().memory->get(p);
+		cache.insert(p,n->getId(),n);
+	}
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(cache.findByPath(paths[i++%paths.size()]));
+}
+BENCHMARK(BM_CacheFindByPath);
+
+static void BM_CacheFindById(benchmark::State &state)
+{
+	Cache cache;
+	std::vector<std::string> ids;
+	for(const std::string &p : shuffled())
+	{
+		INode *n=tree().memory->get(p);
+		ids.push_back(n->getId());
+		cache.insert(p,ids.back(),n);
+	}
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(cache.findById(ids[i++%ids.size()]));
+}
+BENCHMARK(BM_CacheFindById);
+
+static void BM_FillAttr(benchmark::State &state)
+{
+	std::vector<INode*> nodes;
+	for(const std::string &p : shuffled())
+		nodes.push_back(tree().memory->get(p));
+	struct stat st;
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+	{
+		nodes[i++%nodes.size()]->fillAttr(st);
+		benchmark::DoNotOptimize(st);
+	}
+}
+BENCHMARK(BM_FillAttr);
+
+// What g2f_getattr does besides FUSE: lookup through joined file system and
+// stat of node. Hot path is expected to make no allocations
+static void BM_Getattr(benchmark::State &state)
+{
+	IFileSystem &fs=*tree().joined;
+	const std::vector<std::string> &paths=shuffled();
+	struct stat st;
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+	{
+		AbstractFileSystem::Node *n=static_cast<AbstractFileSystem::Node*>(fs.find(paths[i++%paths.size()].c_str()));
+		n->fillAttr(st);
+		benchmark::DoNotOptimize(n->getIdRef().size()+n->getNameRef().size());
+		benchmark::DoNotOptimize(st);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Getattr);
+
+namespace
+{
+	// Cache shared by threads of contention benchmarks
+	struct SharedCache
+	{
+		Cache cache;
+		std::vector<std::string> paths;
+		std::vector<std::string> ids;
+
+		SharedCache()
+			: paths(shuffled())
+		{
+			for(const std::string &p : paths)
+			{
+				INode *n=tree().memory->get(p);
+				ids.push_back(n->getId());
+				cache.insert(p,ids.back(),n);
+			}
+		}
+	};
+
+	SharedCache &sharedCache()
+	{
+		static SharedCache ret;
+		return ret;
+	}
+}
+
+// Lookups of concurrent FUSE threads, every thread walks paths from own offset.
+// Items per second of all threads show how lookups scale with threads
+static void BM_GetattrContended(benchmark::State &state)
+{
+	IFileSystem &fs=*tree().joined;
+	const std::vector<std::string> &paths=shuffled();
+	struct stat st;
+	size_t i=state.thread_index()*paths.size()/state.threads();
+	for(auto _ : state)
+	{
+		INode *n=fs.find(paths[i++%paths.size()].c_str());
+		n->fillAttr(st);
+		benchmark::DoNotOptimize(st);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetattrContended)->ThreadRange(1,64)->UseRealTime();
+
+static void BM_CacheFindByPathContended(benchmark::State &state)
+{
+	SharedCache &sc=sharedCache();
+	size_t i=state.thread_index()*sc.paths.size()/state.threads();
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sc.cache.findByPath(sc.paths[i++%sc.paths.size()]));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CacheFindByPathContended)->ThreadRange(1,64)->UseRealTime();
+
+static void BM_CacheFindByIdContended(benchmark::State &state)
+{
+	SharedCache &sc=sharedCache();
+	size_t i=state.thread_index()*sc.ids.size()/state.threads();
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sc.cache.findById(sc.ids[i++%sc.ids.size()]));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CacheFindByIdContended)->ThreadRange(1,64)->UseRealTime();
+
+#ifdef G2F_HAVE_FUSE
+namespace
+{
+	FuseGate &gate()
+	{
+		static FuseGate *ret=[]()
+		{
+			FuseGate *g=new FuseGate({{"memory",tree().session}});
+			g->prepare();
+			benchContext.private_data=g;
+			return g;
+		}();
+		return *ret;
+	}
+}
+
+static void BM_HandlerGetattr(benchmark::State &state)
+{
+	gate();
+	const std::vector<std::string> &paths=shuffled();
+	struct stat st;
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(g2f_getattr(paths[i++%paths.size()].c_str(),&st));
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HandlerGetattr);
+
+static void BM_HandlerOpenReadRelease(benchmark::State &state)
+{
+	gate();
+	const std::vector<std::string> &paths=shuffled();
+	char buf[4096];
+	size_t i=0;
+	bench::AllocCounter ac(state);
+	for(auto _ : state)
+	{
+		const char *path=paths[i++%paths.size()].c_str();
+		fuse_file_info fi={};
+		fi.flags=O_RDONLY;
+		if(g2f_open(path,&fi)==0)
+		{
+			benchmark::DoNotOptimize(g2f_read(path,buf,sizeof(buf),0,&fi));
+			g2f_release(path,&fi);
+		}
+	}
+}
+BENCHMARK(BM_HandlerOpenReadRelease);
+#endif
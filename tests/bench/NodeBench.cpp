@@ -0,0 +1,131 @@
+// Memory footprint and loading speed of metadata tree: nodes are listed from
+// synthetic cloud with Drive-like ids and names, so nothing but the tree is measured.
+#include "BenchUtils.h"
+#include "support/TestEnv.h"
+#include "fs/AbstractFileSystem.h"
+#include <cstdio>
+
+namespace
+{
+	/**
+	 * @brief Cloud of 'dirs' folders with 'files' files in each
+	 *
+	 *****************************************************/
+	class SyntheticFileSystem : public AbstractFileSystem
+	{
+	public:
+		SyntheticFileSystem(const ContentManagerPtr &cm,size_t dirs,size_t files)
+			: AbstractFileSystem(cm),
+			  _dirs(dirs),
+			  _files(files)
+		{}
+
+		// Lists the whole tree
+		size_t load()
+		{
+			size_t ret=1;
+			getRoot();
+			fillDir(std::string("root"));
+			for(size_t d=0;d<_dirs;++d)
+			{
+				fillDir(_id('d',d));
+				ret+=1+_files;
+			}
+			return ret;
+		}
+
+	protected:
+		virtual void cloudFetchMeta(Node &dest) override
+		{
+			const std::string &id=dest.getId();
+			const timespec t={1500000000,123456789};
+			dest.setTime(ModificationTime,t);
+			dest.setTime(ChangeTime,t);
+			dest.setTime(AccessTime,t);
+			if(id=="root")
+			{
+				dest.setFileType(INode::NodeType::Directory);
+				return;
+			}
+			const size_t n=std::stoul(id.substr(1));
+			if(id[0]=='d')
+			{
+				dest.setFileType(INode::NodeType::Directory);
+				dest.setName("Folder "+std::to_string(n));
+				return;
+			}
+			dest.setName("document-"+std::to_string(n)+".pdf");
+			dest.setSize(100000+n);
+			MD5Signature md5;
+			md5.fill(static_cast<int8_t>(n|1));
+			dest.setMD5(md5);
+			dest.setEtag("\"MTUwMDAwMDAwMA\"");
+		}
+
+		virtual std::vector<std::string> cloudFetchChildrenList(const std::string &parentId) override
+		{
+			std::vector<std::string> ret;
+			if(parentId=="root")
+			{
+				for(size_t d=0;d<_dirs;++d)
+					ret.push_back(_id('d',d));
+			}
+			else
+			{
+				const size_t d=std::stoul(parentId.substr(1));
+				for(size_t f=0;f<_files;++f)
+					ret.push_back(_id('f',d*_files+f));
+			}
+			return ret;
+		}
+
+		virtual void cloudCreateMeta(Node&) override {}
+		virtual ContentManager::IReaderUPtr cloudReadMedia(Node&) override { return nullptr; }
+		virtual void cloudUpdate(Node&,int,const std::string&,ContentManager::IReader*) override {}
+		virtual void cloudRemove(Node&) override {}
+
+	private:
+		// Drive ids are 28 chars (33 for newer ones)
+		static std::string _id(char kind,size_t n)
+		{
+			char buf[32];
+			snprintf(buf,sizeof(buf),"%c%027zu",kind,n);
+			return buf;
+		}
+
+		size_t _dirs;
+		size_t _files;
+	};
+}
+
+// Heap held by loaded tree per node. Nodes come from pool which keeps freed chunks,
+// so the pool is warmed by the first load and chunk of node is added as sizeof(Node)
+static void BM_TreeMemoryPerNode(benchmark::State &state)
+{
+	testenv::app();
+	testenv::TempDir dir;
+	ContentManagerPtr cm=std::make_shared<ContentManager>(dir.path());
+	SyntheticFileSystem(cm,state.range(0),state.range(1)).load();
+
+	size_t nodes=0;
+	int64_t bytes=0;
+	for(auto _ : state)
+	{
+		state.PauseTiming();
+		uptr<SyntheticFileSystem> fs(new SyntheticFileSystem(cm,state.range(0),state.range(1)));
+		fs->getRoot();
+		const int64_t before=bench::liveBytes();
+		state.ResumeTiming();
+
+		nodes=fs->load();
+
+		state.PauseTiming();
+		bytes=bench::liveBytes()-before;
+		fs.reset();
+		state.ResumeTiming();
+	}
+	state.counters["node_size"]=sizeof(AbstractFileSystem::Node);
+	state.counters["bytes_per_node"]=double(bytes)/nodes+sizeof(AbstractFileSystem::Node);
+	state.counters["nodes_per_sec"]=benchmark::Counter(nodes*state.iterations(),benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_TreeMemoryPerNode)->Args({100,100})->Args({100,1000})->Unit(benchmark::kMillisecond)->Iterations(3);
@@ -0,0 +1,293 @@
+// End-to-end benchmark of gd2fuse mounted over local fake Drive server:
+//   mount_bench --gd2fuse <path> [--dirs 20] [--files 50] [--file-size 65536] [--big-size 64M] [--latency 20] [--io-policy <rules>]
+// Reports metadata ops/s, cold and warm 'ls -R' time, sequential and random read/write MB/s
+// and page cache kept for the big file after reading and after reopening (see 'io_policy').
+#include "fake/FakeDrive.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <boost/program_options.hpp>
+
+namespace po=boost::program_options;
+
+namespace
+{
+	const size_t MiB=1024*1024;
+	const size_t BLOCK=4096;
+
+	double seconds(const std::function<void()> &f)
+	{
+		const auto begin=std::chrono::steady_clock::now();
+		f();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+	}
+
+	pid_t spawn(const std::vector<std::string> &args)
+	{
+		std::vector<char*> argv;
+		for(const std::string &a : args)
+			argv.push_back(const_cast<char*>(a.c_str()));
+		argv.push_back(nullptr);
+		pid_t pid=fork();
+		if(pid==0)
+		{
+			execvp(argv[0],argv.data());
+			_exit(127);
+		}
+		return pid;
+	}
+
+	int run(const std::vector<std::string> &args)
+	{
+		int status=0;
+		waitpid(spawn(args),&status,0);
+		return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	}
+
+	bool waitMounted(const fs::path &mnt,pid_t pid)
+	{
+		struct stat parent,dir;
+		stat(mnt.parent_path().c_str(),&parent);
+		for(int i=0;i<300;++i)
+		{
+			if(stat(mnt.c_str(),&dir)==0 && dir.st_dev!=parent.st_dev)
+				return true;
+			if(waitpid(pid,nullptr,WNOHANG)==pid)
+				return false;
+			usleep(100*1000);
+		}
+		return false;
+	}
+
+	// 'ls -R': lists directories and stats entries. Returns files found
+	void walk(const fs::path &dir,std::vector<fs::path> &files)
+	{
+		DIR *d=opendir(dir.c_str());
+		if(!d)
+			return;
+		while(dirent *e=readdir(d))
+		{
+			if(!strcmp(e->d_name,".") || !strcmp(e->d_name,".."))
+				continue;
+			const fs::path &p=dir/e->d_name;
+			struct stat st;
+			if(lstat(p.c_str(),&st)!=0)
+				continue;
+			if(S_ISDIR(st.st_mode))
+				walk(p,files);
+			else
+				files.push_back(p);
+		}
+		closedir(d);
+	}
+
+	// Page cache held by open file (mmap of direct_io file fails, nothing is cached then)
+	double residentMiB(int fd,size_t size)
+	{
+		void *addr=mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+		if(addr==MAP_FAILED)
+			return 0;
+		const size_t page=sysconf(_SC_PAGESIZE);
+		std::vector<unsigned char> pages((size+page-1)/page);
+		size_t resident=0;
+		if(mincore(addr,size,pages.data())==0)
+		{
+			for(unsigned char p : pages)
+				resident+=p&1;
+		}
+		munmap(addr,size);
+		return resident*page/double(MiB);
+	}
+
+	void report(const std::string &name,double value,const char *unit)
+	{
+		std::cout << std::left << std::setw(28) << name << std::right << std::setw(12) << std::fixed
+				  << std::setprecision(2) << value << " " << unit << std::endl;
+	}
+}
+
+int main(int argc,char *argv[])
+{
+	FakeDrive::Options opts;
+	std::string gd2fuse,ioPolicy;
+	size_t dirs=20,files=50,fileSize=64*1024,bigSize=64*MiB,randomOps=1024;
+
+	po::options_description desc("End-to-end benchmark of gd2fuse over fake Drive server");
+	desc.add_options()
+		("help,h",		"help")
+		("gd2fuse",		po::value<std::string>(&gd2fuse)->required(),"path to gd2fuse executable")
+		("dirs",		po::value<size_t>(&dirs),"number of folders")
+		("files",		po::value<size_t>(&files),"number of files per folder")
+		("file-size",	po::value<size_t>(&fileSize),"size of small files (bytes)")
+		("big-size",	po::value<size_t>(&bigSize),"size of file of sequential and random I/O (bytes)")
+		("random-ops",	po::value<size_t>(&randomOps),"number of random 4K reads and writes")
+		("latency",		po::value<unsigned>(&opts.latency),"latency of server responses (ms)")
+		("bandwidth",	po::value<size_t>(&opts.bandwidth),"bandwidth of media download (bytes/sec)")
+		("error-rate",	po::value<double>(&opts.errorRate),"share of failed requests")
+		("io-policy",	po::value<std::string>(&ioPolicy),"rules of kernel caching of opened files ('io_policy' property)");
+	po::variables_map vm;
+	try
+	{
+		po::store(po::parse_command_line(argc,argv,desc),vm);
+		if(vm.count("help"))
+		{
+			std::cout << desc << std::endl;
+			return 0;
+		}
+		po::notify(vm);
+	}
+	catch(const po::error &e)
+	{
+		std::cerr << e.what() << std::endl << desc << std::endl;
+		return 1;
+	}
+
+	char tmpl[]="/tmp/g2f_bench.XXXXXX";
+	const fs::path root=mkdtemp(tmpl);
+	const fs::path conf=root/"conf";
+	const fs::path mnt=root/"mnt";
+	const fs::path gdriveConf=conf/"config"/"gdrive";
+	fs::create_directories(gdriveConf);
+	fs::create_directories(mnt);
+
+	FakeDrive drive(opts);
+	drive.populate(dirs,files,fileSize);
+	std::string big(bigSize,'\0');
+	std::mt19937 random(1);
+	for(char &c : big)
+		c=static_cast<char>(random());
+	drive.addFile("root","big",big);
+	big.clear();
+	drive.start();
+
+	std::ofstream((gdriveConf/G2F_APP_NAME "_secret.json").string()) << drive.getClientSecret();
+	// no trailing new line: property files are read line by line up to EOF
+	{
+		std::ofstream props((gdriveConf/"gdrive.conf").string());
+		props << "api_root_url=" << drive.getRootUrl();
+		if(!ioPolicy.empty())
+			props << std::endl << "io_policy=" << ioPolicy;
+	}
+
+	const std::string email="bench@gmail.com";
+	if(run({gd2fuse,"-m","GETAUTH","--conf-dir",conf.string(),"--email",email,"--auth-code","fake"})!=0)
+	{
+		std::cerr << "authorization against fake server failed" << std::endl;
+		return 1;
+	}
+	pid_t pid=spawn({gd2fuse,"--conf-dir",conf.string(),"--email",email,"-f",mnt.string()});
+	if(!waitMounted(mnt,pid))
+	{
+		std::cerr << "gd2fuse isn't mounted" << std::endl;
+		kill(pid,SIGTERM);
+		return 1;
+	}
+
+	int ret=0;
+	try
+	{
+		std::vector<fs::path> found;
+		report("ls -R cold",seconds([&](){ walk(mnt,found); }),"s");
+		const size_t total=found.size();
+		found.clear();
+		report("ls -R warm",seconds([&](){ walk(mnt,found); }),"s");
+
+		struct stat st;
+		report("stat",total/seconds([&]()
+		{
+			for(const fs::path &p : found)
+				stat(p.c_str(),&st);
+		}),"ops/s");
+
+		const size_t creates=std::min<size_t>(files,100);
+		report("create+unlink",creates/seconds([&]()
+		{
+			for(size_t i=0;i<creates;++i)
+			{
+				const fs::path &p=mnt/("new"+std::to_string(i));
+				close(open(p.c_str(),O_CREAT|O_WRONLY,0644));
+				unlink(p.c_str());
+			}
+		}),"ops/s");
+
+		std::vector<char> buf(MiB);
+		const fs::path bigPath=mnt/"big";
+		int bigFd=-1;
+		report("sequential read cold",bigSize/MiB/seconds([&]()
+		{
+			bigFd=open(bigPath.c_str(),O_RDONLY);
+			while(read(bigFd,buf.data(),buf.size())>0);
+		}),"MB/s");
+		report("page cache after read",residentMiB(bigFd,bigSize),"MB");
+		close(bigFd);
+		// without keep_cache pages of file are dropped by open
+		bigFd=open(bigPath.c_str(),O_RDONLY);
+		report("page cache after reopen",residentMiB(bigFd,bigSize),"MB");
+		close(bigFd);
+		report("sequential read warm",bigSize/MiB/seconds([&]()
+		{
+			int fd=open(bigPath.c_str(),O_RDONLY);
+			while(read(fd,buf.data(),buf.size())>0);
+			close(fd);
+		}),"MB/s");
+
+		std::uniform_int_distribution<size_t> block(0,bigSize/BLOCK-1);
+		report("random read 4K",randomOps*BLOCK/double(MiB)/seconds([&]()
+		{
+			int fd=open(bigPath.c_str(),O_RDONLY);
+			for(size_t i=0;i<randomOps;++i)
+				pread(fd,buf.data(),BLOCK,block(random)*BLOCK);
+			close(fd);
+		}),"MB/s");
+
+		// writes are uploaded on close
+		const fs::path newPath=mnt/"written";
+		report("sequential write",bigSize/MiB/seconds([&]()
+		{
+			int fd=open(newPath.c_str(),O_CREAT|O_WRONLY|O_TRUNC,0644);
+			for(size_t left=bigSize;left;)
+			{
+				ssize_t w=write(fd,buf.data(),std::min(left,buf.size()));
+				if(w<=0)
+					break;
+				left-=w;
+			}
+			close(fd);
+		}),"MB/s");
+		report("random write 4K",randomOps*BLOCK/double(MiB)/seconds([&]()
+		{
+			int fd=open(newPath.c_str(),O_WRONLY);
+			for(size_t i=0;i<randomOps;++i)
+				pwrite(fd,buf.data(),BLOCK,block(random)*BLOCK);
+			close(fd);
+		}),"MB/s");
+
+		const FakeDrive::Stats &s=drive.getStats();
+		report("server requests",s.requests,"");
+		report("server media",s.mediaBytes/double(MiB),"MB");
+	}
+	catch(const std::exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		ret=1;
+	}
+
+	if(run({"fusermount","-u",mnt.string()})!=0)
+		kill(pid,SIGTERM);
+	waitpid(pid,nullptr,0);
+	drive.stop();
+	fs::remove_all(root);
+	return ret;
+}
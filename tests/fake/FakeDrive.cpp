@@ -0,0 +1,869 @@
+#include "FakeDrive.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <ctime>
+#include <sstream>
+#include <stdexcept>
+#include <boost/algorithm/string.hpp>
+#include <boost/uuid/detail/md5.hpp>
+#include <json/json.h>
+
+namespace
+{
+	const char ROOT_ID[]="root";
+	const char FOLDER_MIME[]="application/vnd.google-apps.folder";
+	const char GAPPS_MIME[]="application/vnd.google-apps.";
+
+	std::string rfc3339(time_t t)
+	{
+		char buf[32];
+		tm tmv;
+		gmtime_r(&t,&tmv);
+		strftime(buf,sizeof(buf),"%Y-%m-%dT%H:%M:%S.000Z",&tmv);
+		return buf;
+	}
+
+	time_t parseRfc3339(const std::string &s)
+	{
+		tm tmv={};
+		if(!strptime(s.c_str(),"%Y-%m-%dT%H:%M:%S",&tmv))
+			return 0;
+		return timegm(&tmv);
+	}
+
+	std::string md5hex(const std::string &data)
+	{
+		boost::uuids::detail::md5 md5;
+		md5.process_bytes(data.data(),data.size());
+		boost::uuids::detail::md5::digest_type digest;
+		md5.get_digest(digest);
+		std::string ret;
+		char buf[9];
+		for(unsigned v : digest)
+		{
+			snprintf(buf,sizeof(buf),"%08x",v);
+			ret+=buf;
+		}
+		return ret;
+	}
+
+	std::string urlDecode(const std::string &s)
+	{
+		std::string ret;
+		for(size_t i=0;i<s.size();++i)
+		{
+			if(s[i]=='+')
+				ret+=' ';
+			else if(s[i]=='%' && i+2<s.size())
+			{
+				ret+=static_cast<char>(std::stoi(s.substr(i+1,2),nullptr,16));
+				i+=2;
+			}
+			else
+				ret+=s[i];
+		}
+		return ret;
+	}
+
+	std::string toJson(const Json::Value &v)
+	{
+		Json::StreamWriterBuilder b;
+		b["indentation"]="";
+		return Json::writeString(b,v);
+	}
+
+	bool fromJson(const std::string &s,Json::Value &v)
+	{
+		Json::CharReaderBuilder b;
+		std::string errs;
+		std::istringstream in(s);
+		return Json::parseFromStream(b,in,&v,&errs);
+	}
+
+	// Bodies of parts of multipart/related content
+	std::vector<std::string> splitMultipart(const std::string &contentType,const std::string &data)
+	{
+		std::vector<std::string> ret;
+		size_t b=contentType.find("boundary=");
+		if(b==std::string::npos)
+			return ret;
+		const std::string &boundary="--"+boost::trim_copy_if(contentType.substr(b+9),boost::is_any_of("\""));
+		size_t pos=0;
+		while((pos=data.find(boundary,pos))!=std::string::npos)
+		{
+			pos+=boundary.size();
+			size_t start=data.find("\r\n\r\n",pos);
+			size_t end=data.find("\r\n"+boundary,pos);
+			if(start==std::string::npos || end==std::string::npos || start>end)
+				break;
+			ret.push_back(data.substr(start+4,end-start-4));
+		}
+		return ret;
+	}
+
+	bool sendAll(int sock,const char *data,size_t size)
+	{
+		while(size)
+		{
+			ssize_t sent=send(sock,data,size,MSG_NOSIGNAL);
+			if(sent<=0)
+				return false;
+			data+=sent;
+			size-=sent;
+		}
+		return true;
+	}
+
+	const char *statusText(int status)
+	{
+		switch(status)
+		{
+		case 200: return "OK";
+		case 204: return "No Content";
+		case 400: return "Bad Request";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 429: return "Too Many Requests";
+		case 500: return "Internal Server Error";
+		case 501: return "Not Implemented";
+		case 503: return "Service Unavailable";
+		}
+		return "Unknown";
+	}
+}
+
+
+
+
+
+FakeDrive::FakeDrive()
+	: FakeDrive(Options())
+{}
+
+FakeDrive::FakeDrive(const Options &opts)
+{
+	setOptions(opts);
+	File &root=_files[ROOT_ID];
+	root.id=ROOT_ID;
+	root.title="My Drive";
+	root.mimeType=FOLDER_MIME;
+	root.created=root.modified=time(nullptr);
+	root.changeId=_lastChangeId;
+}
+
+FakeDrive::~FakeDrive()
+{
+	stop();
+}
+
+uint16_t FakeDrive::start(uint16_t port)
+{
+	_listen=socket(AF_INET,SOCK_STREAM,0);
+	if(_listen<0)
+		throw std::runtime_error("FakeDrive: socket() failed");
+	int on=1;
+	setsockopt(_listen,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+	sockaddr_in addr={};
+	addr.sin_family=AF_INET;
+	addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+	addr.sin_port=htons(port);
+	socklen_t len=sizeof(addr);
+	if(bind(_listen,reinterpret_cast<sockaddr*>(&addr),len)!=0 || listen(_listen,64)!=0 ||
+	   getsockname(_listen,reinterpret_cast<sockaddr*>(&addr),&len)!=0)
+	{
+		close(_listen);
+		_listen=-1;
+		throw std::runtime_error("FakeDrive: can't listen on port "+std::to_string(port));
+	}
+	_port=ntohs(addr.sin_port);
+	_stopping=false;
+	_acceptThread=std::thread(&FakeDrive::_accept,this);
+	return _port;
+}
+
+void FakeDrive::stop()
+{
+	if(_listen<0)
+		return;
+	_stopping=true;
+	shutdown(_listen,SHUT_RDWR);
+	_acceptThread.join();
+	close(_listen);
+	_listen=-1;
+
+	std::vector<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> lock(_connM);
+		for(int s : _conns)
+			shutdown(s,SHUT_RDWR);
+		threads.swap(_connThreads);
+	}
+	for(std::thread &t : threads)
+		t.join();
+}
+
+std::string FakeDrive::getRootUrl() const
+{
+	return "http://127.0.0.1:"+std::to_string(_port)+"/";
+}
+
+std::string FakeDrive::getClientSecret() const
+{
+	Json::Value installed;
+	installed["client_id"]="fake.apps.googleusercontent.com";
+	installed["client_secret"]="fake";
+	installed["auth_uri"]=getRootUrl()+"o/oauth2/auth";
+	installed["token_uri"]=getRootUrl()+"o/oauth2/token";
+	installed["redirect_uris"].append("urn:ietf:wg:oauth:2.0:oob");
+	Json::Value ret;
+	ret["installed"]=installed;
+	return toJson(ret);
+}
+
+void FakeDrive::setOptions(const Options &opts)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	_opts=opts;
+	_quota.reset(opts.quotaRate>0 ? new TokenBucket(opts.quotaRate,opts.quotaBurst) : nullptr);
+	_random.seed(opts.seed);
+}
+
+FakeDrive::Stats FakeDrive::getStats()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _stats;
+}
+
+void FakeDrive::resetStats()
+{
+	std::lock_guard<std::mutex> lock(_m);
+	_stats=Stats();
+}
+
+std::string FakeDrive::addFolder(const std::string &parentId,const std::string &title)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	return _add(parentId,title,FOLDER_MIME).id;
+}
+
+std::string FakeDrive::addFile(const std::string &parentId,const std::string &title,const std::string &content,
+							   const std::string &mimeType)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	File &f=_add(parentId,title,mimeType);
+	f.content=content;
+	return f.id;
+}
+
+bool FakeDrive::getContent(const std::string &id,std::string &content)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	File *f=_find(id);
+	if(!f)
+		return false;
+	content=f->content;
+	return true;
+}
+
+std::string FakeDrive::findByTitle(const std::string &parentId,const std::string &title)
+{
+	std::lock_guard<std::mutex> lock(_m);
+	for(const auto &f : _files)
+		if(!f.second.deleted && f.second.parent==parentId && f.second.title==title)
+			return f.first;
+	return std::string();
+}
+
+void FakeDrive::populate(size_t dirs,size_t files,size_t fileSize)
+{
+	std::mt19937 random(1);
+	auto content=[&]()
+	{
+		std::string ret(fileSize,'\0');
+		for(char &c : ret)
+			c=static_cast<char>(random());
+		return ret;
+	};
+
+	for(size_t f=0;f<files;++f)
+		addFile(ROOT_ID,"file"+std::to_string(f),content());
+	for(size_t d=0;d<dirs;++d)
+	{
+		const std::string &dirId=addFolder(ROOT_ID,"dir"+std::to_string(d));
+		for(size_t f=0;f<files;++f)
+			addFile(dirId,"file"+std::to_string(f),content());
+	}
+}
+
+void FakeDrive::_accept()
+{
+	while(!_stopping)
+	{
+		int s=accept(_listen,nullptr,nullptr);
+		if(s<0)
+			continue;
+		std::lock_guard<std::mutex> lock(_connM);
+		if(_stopping)
+		{
+			close(s);
+			break;
+		}
+		_conns.push_back(s);
+		_connThreads.emplace_back(&FakeDrive::_serve,this,s);
+	}
+}
+
+void FakeDrive::_serve(int sock)
+{
+	std::string buffer;
+	Request req;
+	while(!_stopping && _readRequest(sock,buffer,req))
+	{
+		{
+			std::lock_guard<std::mutex> lock(_m);
+			++_stats.requests;
+			_stats.maxConcurrency=std::max(_stats.maxConcurrency,++_running);
+		}
+		const Response &resp=_dispatch(req);
+		_writeResponse(sock,resp);
+		{
+			std::lock_guard<std::mutex> lock(_m);
+			--_running;
+		}
+		if(boost::iequals(req.headers["connection"],"close"))
+			break;
+	}
+
+	std::lock_guard<std::mutex> lock(_connM);
+	_conns.erase(std::remove(_conns.begin(),_conns.end(),sock),_conns.end());
+	close(sock);
+}
+
+bool FakeDrive::_readRequest(int sock,std::string &buffer,Request &req)
+{
+	char chunk[64*1024];
+	auto fill=[&]()
+	{
+		ssize_t readed=recv(sock,chunk,sizeof(chunk),0);
+		if(readed<=0)
+			return false;
+		buffer.append(chunk,readed);
+		return true;
+	};
+
+	size_t headEnd;
+	while((headEnd=buffer.find("\r\n\r\n"))==std::string::npos)
+		if(!fill())
+			return false;
+
+	req=Request();
+	std::vector<std::string> lines;
+	boost::split(lines,buffer.substr(0,headEnd),boost::is_any_of("\n"));
+	buffer.erase(0,headEnd+4);
+
+	std::vector<std::string> first;
+	boost::split(first,boost::trim_copy(lines[0]),boost::is_space(),boost::token_compress_on);
+	if(first.size()<2)
+		return false;
+	req.method=first[0];
+	const std::string &target=first[1];
+	size_t q=target.find('?');
+	req.path=urlDecode(target.substr(0,q));
+	if(q!=std::string::npos)
+	{
+		std::vector<std::string> params;
+		boost::split(params,target.substr(q+1),boost::is_any_of("&"));
+		for(const std::string &p : params)
+		{
+			size_t eq=p.find('=');
+			req.query[urlDecode(p.substr(0,eq))]=eq==std::string::npos ? std::string() : urlDecode(p.substr(eq+1));
+		}
+	}
+	for(size_t i=1;i<lines.size();++i)
+	{
+		size_t colon=lines[i].find(':');
+		if(colon!=std::string::npos)
+			req.headers[boost::to_lower_copy(boost::trim_copy(lines[i].substr(0,colon)))]=boost::trim_copy(lines[i].substr(colon+1));
+	}
+
+	if(boost::iequals(req.headers["expect"],"100-continue"))
+		sendAll(sock,"HTTP/1.1 100 Continue\r\n\r\n",25);
+
+	if(boost::iequals(req.headers["transfer-encoding"],"chunked"))
+	{
+		for(;;)
+		{
+			size_t eol;
+			while((eol=buffer.find("\r\n"))==std::string::npos)
+				if(!fill())
+					return false;
+			size_t size=std::stoul(buffer.substr(0,eol),nullptr,16);
+			while(buffer.size()<eol+2+size+2)
+				if(!fill())
+					return false;
+			req.body.append(buffer,eol+2,size);
+			buffer.erase(0,eol+2+size+2);
+			if(size==0)
+				break;
+		}
+	}
+	else
+	{
+		const std::string &cl=req.headers["content-length"];
+		size_t size=cl.empty() ? 0 : std::stoul(cl);
+		while(buffer.size()<size)
+			if(!fill())
+				return false;
+		req.body=buffer.substr(0,size);
+		buffer.erase(0,size);
+	}
+	return true;
+}
+
+void FakeDrive::_writeResponse(int sock,const Response &resp)
+{
+	size_t bandwidth;
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		bandwidth=_opts.bandwidth;
+		if(resp.media)
+			_stats.mediaBytes+=resp.body.size();
+	}
+
+	std::string head="HTTP/1.1 "+std::to_string(resp.status)+" "+statusText(resp.status)+"\r\n";
+	head+="Content-Type: "+resp.contentType+"\r\n";
+	head+="Content-Length: "+std::to_string(resp.body.size())+"\r\n\r\n";
+	if(!sendAll(sock,head.data(),head.size()))
+		return;
+	if(!resp.media || !bandwidth)
+	{
+		sendAll(sock,resp.body.data(),resp.body.size());
+		return;
+	}
+
+	// chunks are paced to keep the average rate
+	const size_t CHUNK=64*1024;
+	const auto begin=std::chrono::steady_clock::now();
+	for(size_t sent=0;sent<resp.body.size();)
+	{
+		size_t len=std::min(CHUNK,resp.body.size()-sent);
+		std::this_thread::sleep_until(begin+std::chrono::microseconds((sent+len)*1000000/bandwidth));
+		if(!sendAll(sock,resp.body.data()+sent,len))
+			return;
+		sent+=len;
+	}
+}
+
+FakeDrive::Response FakeDrive::_dispatch(const Request &req)
+{
+	unsigned latency;
+	Response ret;
+	bool injected=false;
+	{
+		std::lock_guard<std::mutex> lock(_m);
+		latency=_opts.latency;
+		if(req.path!="/o/oauth2/token")
+		{
+			if(_quota && !_quota->tryAcquire())
+			{
+				++_stats.throttled;
+				ret=_error(403,"userRateLimitExceeded","User Rate Limit Exceeded");
+				injected=true;
+			}
+			else if(_opts.errorRate>0 && std::uniform_real_distribution<double>(0,1)(_random)<_opts.errorRate)
+			{
+				++_stats.failed;
+				ret=_error(_opts.errorStatus,"backendError","Injected error");
+				injected=true;
+			}
+		}
+	}
+	if(latency)
+		std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+	if(injected)
+		return ret;
+
+	if(req.path=="/o/oauth2/token")
+	{
+		Json::Value token;
+		token["access_token"]="fake-access-token";
+		token["refresh_token"]="fake-refresh-token";
+		token["token_type"]="Bearer";
+		token["expires_in"]=3600;
+		ret.body=toJson(token);
+		return ret;
+	}
+	if(boost::starts_with(req.path,"/drive/v2/"))
+		return _dispatchDrive(req,req.path.substr(10),false);
+	if(boost::starts_with(req.path,"/upload/drive/v2/"))
+		return _dispatchDrive(req,req.path.substr(17),true);
+	return _error(404,"notFound","Unknown path "+req.path);
+}
+
+FakeDrive::Response FakeDrive::_dispatchDrive(const Request &req,const std::string &path,bool upload)
+{
+	std::vector<std::string> parts;
+	boost::split(parts,path,boost::is_any_of("/"));
+	auto param=[&req](const char *name)
+	{
+		auto it=req.query.find(name);
+		return it==req.query.end() ? std::string() : it->second;
+	};
+
+	std::lock_guard<std::mutex> lock(_m);
+	Response ret;
+	if(parts[0]=="about" && req.method=="GET")
+	{
+		Json::Value about;
+		about["largestChangeId"]=std::to_string(_lastChangeId);
+		about["rootFolderId"]=ROOT_ID;
+		ret.body=toJson(about);
+		return ret;
+	}
+	if(parts[0]=="changes" && req.method=="GET")
+		return _changes(req);
+	if(parts[0]=="drives" && req.method=="GET")
+	{
+		ret.body="{\"items\":[]}";
+		return ret;
+	}
+	if(parts[0]!="files")
+		return _error(404,"notFound","Unknown resource "+parts[0]);
+
+	if(parts.size()==1)
+	{
+		if(req.method=="GET")
+			return _list(req);
+		if(req.method!="POST")
+			return _error(400,"badRequest","Unsupported method");
+
+		// insert
+		File &f=_add(ROOT_ID,"Untitled","application/octet-stream");
+		std::string meta=req.body;
+		if(upload)
+		{
+			const std::string &type=param("uploadType");
+			if(type=="media")
+			{
+				f.content=req.body;
+				meta.clear();
+			}
+			else if(type=="multipart")
+			{
+				// metadata part and content part
+				const std::vector<std::string> &body=splitMultipart(req.headers.at("content-type"),req.body);
+				meta=body.size()>0 ? body[0] : std::string();
+				if(body.size()>1)
+					f.content=body[1];
+			}
+			else
+				return _error(501,"notImplemented","Upload type '"+type+"' isn't supported");
+		}
+		if(!meta.empty())
+			_applyMeta(f,meta);
+		_stats.mediaBytes+=f.content.size();
+		ret.body=_fileJson(f);
+		return ret;
+	}
+
+	File *f=_find(parts[1]);
+	if(!f)
+		return _error(404,"notFound","File not found: "+parts[1]);
+
+	if(parts.size()==2)
+	{
+		if(req.method=="GET")
+		{
+			if(param("alt")=="media")
+			{
+				if(f->mimeType==FOLDER_MIME || boost::starts_with(f->mimeType,GAPPS_MIME))
+					return _error(403,"fileNotDownloadable","Only files with binary content can be downloaded");
+				ret.contentType=f->mimeType;
+				ret.body=f->content;
+				ret.media=true;
+				return ret;
+			}
+			ret.body=_fileJson(*f);
+			return ret;
+		}
+		if(req.method=="DELETE")
+		{
+			// content of subtree isn't reachable anymore
+			std::vector<File*> stack{f};
+			while(!stack.empty())
+			{
+				File *d=stack.back();
+				stack.pop_back();
+				for(auto &c : _files)
+					if(!c.second.deleted && c.second.parent==d->id)
+						stack.push_back(&c.second);
+				d->deleted=true;
+				d->content.clear();
+				_touch(*d);
+			}
+			ret.status=204;
+			return ret;
+		}
+		if(req.method=="PUT" || req.method=="PATCH")
+		{
+			std::string meta=req.body;
+			if(upload)
+			{
+				const std::string &type=param("uploadType");
+				if(type=="media")
+				{
+					f->content=req.body;
+					meta.clear();
+				}
+				else if(type=="multipart")
+				{
+					const std::vector<std::string> &body=splitMultipart(req.headers.at("content-type"),req.body);
+					meta=body.size()>0 ? body[0] : std::string();
+					if(body.size()>1)
+						f->content=body[1];
+				}
+				else
+					return _error(501,"notImplemented","Upload type '"+type+"' isn't supported");
+				_stats.mediaBytes+=f->content.size();
+			}
+			if(!meta.empty())
+				_applyMeta(*f,meta);
+			_touch(*f);
+			ret.body=_fileJson(*f);
+			return ret;
+		}
+		return _error(400,"badRequest","Unsupported method");
+	}
+
+	if(parts[2]=="children" && req.method=="GET")
+	{
+		Json::Value items(Json::arrayValue);
+		for(const auto &c : _files)
+			if(!c.second.deleted && !c.second.trashed && c.second.parent==f->id)
+			{
+				Json::Value item;
+				item["id"]=c.first;
+				items.append(item);
+			}
+		Json::Value list;
+		list["etag"]="\""+std::to_string(_lastChangeId)+"\"";
+		list["items"]=items;
+		ret.body=toJson(list);
+		return ret;
+	}
+	if(parts[2]=="copy" && req.method=="POST")
+	{
+		File source=*f;
+		File &copy=_add(source.parent,source.title,source.mimeType);
+		copy.content=source.content;
+		if(!req.body.empty())
+			_applyMeta(copy,req.body);
+		ret.body=_fileJson(copy);
+		return ret;
+	}
+	if(parts[2]=="trash" && req.method=="POST")
+	{
+		f->trashed=true;
+		_touch(*f);
+		ret.body=_fileJson(*f);
+		return ret;
+	}
+	if(parts[2]=="export" && req.method=="GET")
+	{
+		if(!boost::starts_with(f->mimeType,GAPPS_MIME) || f->mimeType==FOLDER_MIME)
+			return _error(403,"exportOnlySupportedOnGoogleDocs","Export only supports Google Docs");
+		ret.contentType=param("mimeType");
+		ret.body=f->content;
+		ret.media=true;
+		return ret;
+	}
+	return _error(404,"notFound","Unknown method "+path);
+}
+
+FakeDrive::File *FakeDrive::_find(const std::string &id)
+{
+	auto it=_files.find(id);
+	if(it==_files.end() || it->second.deleted)
+		return nullptr;
+	return &it->second;
+}
+
+FakeDrive::File &FakeDrive::_add(const std::string &parentId,const std::string &title,const std::string &mimeType)
+{
+	// ids have length of real ones
+	char buf[32];
+	snprintf(buf,sizeof(buf),"fake%024zu",++_lastId);
+	File &f=_files[buf];
+	f.id=buf;
+	f.parent=parentId;
+	f.title=title;
+	f.mimeType=mimeType;
+	f.created=time(nullptr);
+	_touch(f);
+	return f;
+}
+
+void FakeDrive::_touch(File &f)
+{
+	f.modified=time(nullptr);
+	f.changeId=++_lastChangeId;
+}
+
+std::string FakeDrive::_fileJson(const File &f)
+{
+	Json::Value v;
+	v["kind"]="drive#file";
+	v["id"]=f.id;
+	v["etag"]="\""+std::to_string(f.changeId)+"\"";
+	v["title"]=f.title;
+	v["mimeType"]=f.mimeType;
+	v["createdDate"]=rfc3339(f.created);
+	v["modifiedDate"]=rfc3339(f.modified);
+	v["lastViewedByMeDate"]=rfc3339(f.modified);
+	if(f.mimeType!=FOLDER_MIME && !boost::starts_with(f.mimeType,GAPPS_MIME))
+	{
+		v["fileSize"]=std::to_string(f.content.size());
+		v["md5Checksum"]=md5hex(f.content);
+	}
+	if(!f.parent.empty())
+	{
+		Json::Value p;
+		p["id"]=f.parent;
+		v["parents"].append(p);
+	}
+	v["labels"]["trashed"]=f.trashed;
+	return toJson(v);
+}
+
+FakeDrive::Response FakeDrive::_list(const Request &req)
+{
+	// supported query: clauses "'<id>' in parents", "trashed=false" and "modifiedDate <op> '<date>'" joined by "and"
+	std::string parent;
+	bool notTrashed=false;
+	time_t minModified=0;
+	time_t maxModified=std::numeric_limits<time_t>::max();
+	auto q=req.query.find("q");
+	if(q!=req.query.end())
+	{
+		const std::string &query=q->second;
+		for(size_t pos=0,next;pos<query.size();pos=next+5)
+		{
+			next=std::min(query.find(" and ",pos),query.size());
+			const std::string &c=boost::trim_copy(query.substr(pos,next-pos));
+			if(boost::ends_with(c," in parents"))
+				parent=boost::trim_copy_if(c.substr(0,c.size()-11),boost::is_any_of("'"));
+			else if(boost::erase_all_copy(c," ")=="trashed=false")
+				notTrashed=true;
+			else if(boost::starts_with(c,"modifiedDate >= '"))
+				minModified=parseRfc3339(c.substr(17));
+			else if(boost::starts_with(c,"modifiedDate < '"))
+				maxModified=parseRfc3339(c.substr(16));
+			else
+				return _error(400,"invalid","Unsupported query clause: "+c);
+		}
+	}
+
+	size_t maxResults=req.query.count("maxResults") ? std::stoul(req.query.at("maxResults")) : 100;
+	auto from=req.query.find("pageToken");
+	auto it=from==req.query.end() ? _files.begin() : _files.lower_bound(from->second);
+
+	Json::Value items(Json::arrayValue);
+	Json::Value list;
+	for(;it!=_files.end();++it)
+	{
+		const File &f=it->second;
+		if(f.deleted || f.id==ROOT_ID || (notTrashed && f.trashed) || (!parent.empty() && f.parent!=parent) ||
+		   f.modified<minModified || f.modified>=maxModified)
+			continue;
+		if(items.size()==maxResults)
+		{
+			list["nextPageToken"]=it->first;
+			break;
+		}
+		Json::Value v;
+		fromJson(_fileJson(f),v);
+		items.append(v);
+	}
+	list["items"]=items;
+	Response ret;
+	ret.body=toJson(list);
+	return ret;
+}
+
+FakeDrive::Response FakeDrive::_changes(const Request &req)
+{
+	auto start=req.query.find("pageToken");
+	if(start==req.query.end())
+		start=req.query.find("startChangeId");
+	const int64_t from=start==req.query.end() ? 1 : std::stoll(start->second);
+	const size_t maxResults=req.query.count("maxResults") ? std::stoul(req.query.at("maxResults")) : 100;
+
+	std::map<int64_t,const File*> changed;
+	for(const auto &f : _files)
+		if(f.second.changeId>=from)
+			changed[f.second.changeId]=&f.second;
+
+	Json::Value items(Json::arrayValue);
+	Json::Value list;
+	for(const auto &c : changed)
+	{
+		if(items.size()==maxResults)
+		{
+			list["nextPageToken"]=std::to_string(c.first);
+			break;
+		}
+		Json::Value item;
+		item["kind"]="drive#change";
+		item["id"]=std::to_string(c.first);
+		item["fileId"]=c.second->id;
+		item["deleted"]=c.second->deleted;
+		if(!c.second->deleted)
+			fromJson(_fileJson(*c.second),item["file"]);
+		items.append(item);
+	}
+	list["largestChangeId"]=std::to_string(_lastChangeId);
+	list["items"]=items;
+	Response ret;
+	ret.body=toJson(list);
+	return ret;
+}
+
+void FakeDrive::_applyMeta(File &f,const std::string &json)
+{
+	Json::Value v;
+	if(!fromJson(json,v) || !v.isObject())
+		return;
+	if(v.isMember("title"))
+		f.title=v["title"].asString();
+	if(v.isMember("mimeType"))
+		f.mimeType=v["mimeType"].asString();
+	if(v.isMember("parents") && v["parents"].size()>0)
+		f.parent=v["parents"][0].get("id","").asString();
+	_touch(f);
+	if(v.isMember("modifiedDate"))
+		f.modified=parseRfc3339(v["modifiedDate"].asString());
+}
+
+FakeDrive::Response FakeDrive::_error(int status,const std::string &reason,const std::string &message)
+{
+	Json::Value e;
+	e["domain"]=status==403 ? "usageLimits" : "global";
+	e["reason"]=reason;
+	e["message"]=message;
+	Json::Value err;
+	err["errors"].append(e);
+	err["code"]=status;
+	err["message"]=message;
+	Json::Value body;
+	body["error"]=err;
+
+	Response ret;
+	ret.status=status;
+	ret.body=toJson(body);
+	return ret;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "utils/decls.h"
+#include "utils/TokenBucket.h"
+
+/**
+ * @brief Local stand-in of Google Drive API v2
+ *
+ * Serves over HTTP the subset of API used by GoogleFileSystem: files
+ * get/list/insert/update/delete/copy/export, children list, changes,
+ * about, shared drives list and OAuth2 token endpoint. Point gd2fuse
+ * to it by 'api_root_url' property and 'token_uri' of client secret.
+ *
+ * Latency, bandwidth of media and errors are injected by Options.
+ *********************************************************************/
+class FakeDrive
+{
+public:
+	struct Options
+	{
+		unsigned latency=0;				// added to every response (ms)
+		size_t bandwidth=0;				// of media download (bytes/sec, 0 - unlimited)
+		double errorRate=0;				// share of requests failed with 'errorStatus'
+		int errorStatus=503;
+		double quotaRate=0;				// requests/sec over that are answered 403 userRateLimitExceeded (0 - no quota)
+		size_t quotaBurst=1;
+		unsigned seed=1;
+	};
+
+	struct Stats
+	{
+		size_t requests=0;
+		size_t throttled=0;			// answered by quota error
+		size_t failed=0;			// answered by injected error
+		size_t mediaBytes=0;		// content sent and received
+		size_t maxConcurrency=0;	// max number of requests served at once
+	};
+
+	FakeDrive();
+	FakeDrive(const Options &opts);
+	~FakeDrive();
+
+	// Listens on loopback (0 - any free port). Returns port
+	uint16_t start(uint16_t port=0);
+	void stop();
+	// Root URL of API, value of 'api_root_url' property
+	std::string getRootUrl() const;
+	// Client secret JSON with token URI of the server
+	std::string getClientSecret() const;
+
+	void setOptions(const Options &opts);
+	Stats getStats();
+	void resetStats();
+
+	// Drive content. Parent "root" is root of drive
+	std::string addFolder(const std::string &parentId,const std::string &title);
+	std::string addFile(const std::string &parentId,const std::string &title,const std::string &content,
+						const std::string &mimeType="application/octet-stream");
+	bool getContent(const std::string &id,std::string &content);
+	std::string findByTitle(const std::string &parentId,const std::string &title);
+	// Adds 'dirs' folders with 'files' files of 'fileSize' bytes into root and into each of them
+	void populate(size_t dirs,size_t files,size_t fileSize);
+
+private:
+	struct File
+	{
+		std::string id;
+		std::string title;
+		std::string mimeType;
+		std::string parent;
+		std::string content;
+		time_t created=0;
+		time_t modified=0;
+		bool trashed=false;
+		bool deleted=false;			// is kept for change list
+		int64_t changeId=0;
+	};
+
+	struct Request
+	{
+		std::string method;
+		std::string path;
+		std::map<std::string,std::string> query;
+		std::map<std::string,std::string> headers;	// names in lower case
+		std::string body;
+	};
+
+	struct Response
+	{
+		int status=200;
+		std::string contentType="application/json";
+		std::string body;
+		bool media=false;			// body is sent at limited bandwidth
+	};
+
+	void _accept();
+	void _serve(int sock);
+	bool _readRequest(int sock,std::string &buffer,Request &req);
+	void _writeResponse(int sock,const Response &resp);
+	Response _dispatch(const Request &req);
+	Response _dispatchDrive(const Request &req,const std::string &path,bool upload);
+
+	// Must be called under _m
+	File *_find(const std::string &id);
+	File &_add(const std::string &parentId,const std::string &title,const std::string &mimeType);
+	void _touch(File &f);
+	std::string _fileJson(const File &f);
+	Response _list(const Request &req);
+	Response _changes(const Request &req);
+	void _applyMeta(File &f,const std::string &json);
+
+	static Response _error(int status,const std::string &reason,const std::string &message);
+
+	Options _opts;
+	mutable std::mutex _m;
+	std::map<std::string,File> _files;
+	int64_t _lastChangeId=1;
+	size_t _lastId=0;
+	Stats _stats;
+	size_t _running=0;
+	uptr<TokenBucket> _quota;
+	std::mt19937 _random;
+
+	int _listen=-1;
+	uint16_t _port=0;
+	std::atomic<bool> _stopping{false};
+	std::thread _acceptThread;
+	std::mutex _connM;
+	std::vector<int> _conns;
+	std::vector<std::thread> _connThreads;
+};
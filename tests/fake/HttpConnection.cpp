@@ -0,0 +1,108 @@
+#include "HttpConnection.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+
+HttpConnection::HttpConnection(const std::string &method,const std::string &url,const std::string &body,
+							   const std::string &contentType)
+{
+	// only http://<ipv4>:<port>/<path>
+	if(!boost::starts_with(url,"http://"))
+		throw std::runtime_error("HttpConnection: unsupported URL "+url);
+	size_t hostEnd=url.find('/',7);
+	const std::string &hostPort=url.substr(7,hostEnd-7);
+	const std::string &target=hostEnd==std::string::npos ? "/" : url.substr(hostEnd);
+	size_t colon=hostPort.find(':');
+
+	sockaddr_in addr={};
+	addr.sin_family=AF_INET;
+	addr.sin_port=htons(colon==std::string::npos ? 80 : std::stoi(hostPort.substr(colon+1)));
+	inet_pton(AF_INET,hostPort.substr(0,colon).c_str(),&addr.sin_addr);
+	_sock=socket(AF_INET,SOCK_STREAM,0);
+	if(_sock<0 || connect(_sock,reinterpret_cast<sockaddr*>(&addr),sizeof(addr))!=0)
+	{
+		if(_sock>=0)
+			close(_sock);
+		throw std::runtime_error("HttpConnection: can't connect to "+hostPort);
+	}
+
+	std::string req=method+" "+target+" HTTP/1.1\r\nHost: "+hostPort+"\r\nConnection: close\r\n";
+	if(!body.empty() || method=="POST" || method=="PUT")
+		req+="Content-Type: "+contentType+"\r\nContent-Length: "+std::to_string(body.size())+"\r\n";
+	req+="\r\n";
+	req+=body;
+	for(size_t sent=0;sent<req.size();)
+	{
+		ssize_t s=send(_sock,req.data()+sent,req.size()-sent,MSG_NOSIGNAL);
+		if(s<=0)
+			throw std::runtime_error("HttpConnection: fail to send request");
+		sent+=s;
+	}
+
+	size_t headEnd;
+	char chunk[16*1024];
+	while((headEnd=_buffer.find("\r\n\r\n"))==std::string::npos)
+	{
+		ssize_t r=recv(_sock,chunk,sizeof(chunk),0);
+		if(r<=0)
+			throw std::runtime_error("HttpConnection: no response");
+		_buffer.append(chunk,r);
+	}
+	std::vector<std::string> lines;
+	boost::split(lines,_buffer.substr(0,headEnd),boost::is_any_of("\n"));
+	_buffer.erase(0,headEnd+4);
+	std::vector<std::string> first;
+	boost::split(first,lines[0],boost::is_space(),boost::token_compress_on);
+	_status=first.size()>1 ? std::stoi(first[1]) : 0;
+	for(const std::string &l : lines)
+		if(boost::istarts_with(l,"content-length:"))
+			_length=std::stoul(boost::trim_copy(l.substr(15)));
+}
+
+HttpConnection::~HttpConnection()
+{
+	close(_sock);
+}
+
+int HttpConnection::getStatus() const
+{
+	return _status;
+}
+
+size_t HttpConnection::getContentLength() const
+{
+	return _length;
+}
+
+int64_t HttpConnection::read(char *buffer,size_t size)
+{
+	size=std::min(size,_length-_readed);
+	if(size==0)
+		return 0;
+	int64_t ret;
+	if(!_buffer.empty())
+	{
+		ret=std::min(size,_buffer.size());
+		memcpy(buffer,_buffer.data(),ret);
+		_buffer.erase(0,ret);
+	}
+	else if((ret=recv(_sock,buffer,size,0))<=0)
+		return -1;
+	_readed+=ret;
+	return ret;
+}
+
+std::string HttpConnection::readAll()
+{
+	std::string ret;
+	char chunk[64*1024];
+	int64_t r;
+	while((r=read(chunk,sizeof(chunk)))>0)
+		ret.append(chunk,r);
+	return ret;
+}
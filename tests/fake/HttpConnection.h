@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Blocking HTTP/1.1 request over its own connection
+ *
+ * Minimal client of tests: request is sent by constructor, body of
+ * response (only with Content-Length) is read on demand.
+ *********************************************************************/
+class HttpConnection
+{
+public:
+	// Throws std::runtime_error if server isn't reachable
+	HttpConnection(const std::string &method,const std::string &url,const std::string &body=std::string(),
+				   const std::string &contentType="application/json");
+	~HttpConnection();
+
+	HttpConnection(const HttpConnection&)=delete;
+	HttpConnection &operator=(const HttpConnection&)=delete;
+
+	int getStatus() const;
+	size_t getContentLength() const;
+
+	// Returns 0 at end of body, -1 on error
+	int64_t read(char *buffer,size_t size);
+	std::string readAll();
+
+private:
+	int _sock=-1;
+	int _status=0;
+	size_t _length=0;
+	size_t _readed=0;
+	std::string _buffer;		// body read with headers
+};
@@ -0,0 +1,70 @@
+// Standalone fake Drive server for manual runs of gd2fuse:
+//   fake_drive --port 8080 --dirs 10 --files 100 &
+//   gd2fuse -p api_root_url=http://127.0.0.1:8080/ ...
+#include "FakeDrive.h"
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+namespace po=boost::program_options;
+
+int main(int argc,char *argv[])
+{
+	FakeDrive::Options opts;
+	uint16_t port=0;
+	size_t dirs=0,files=0,fileSize=0;
+	std::string secretFile;
+
+	po::options_description desc("Local stand-in of Google Drive API v2");
+	desc.add_options()
+		("help,h",		"help")
+		("port",		po::value<uint16_t>(&port),"port to listen (0 - any free)")
+		("latency",		po::value<unsigned>(&opts.latency),"latency of responses (ms)")
+		("bandwidth",	po::value<size_t>(&opts.bandwidth),"bandwidth of media download (bytes/sec)")
+		("error-rate",	po::value<double>(&opts.errorRate),"share of failed requests")
+		("error-status",po::value<int>(&opts.errorStatus),"HTTP status of failed requests")
+		("quota-rate",	po::value<double>(&opts.quotaRate),"requests/sec over that are answered by quota error")
+		("quota-burst",	po::value<size_t>(&opts.quotaBurst),"burst of requests allowed by quota")
+		("dirs",		po::value<size_t>(&dirs),"number of generated folders")
+		("files",		po::value<size_t>(&files),"number of generated files per folder")
+		("file-size",	po::value<size_t>(&fileSize),"size of generated files (bytes)")
+		("secret",		po::value<std::string>(&secretFile),"write client secret with token URI of the server to file");
+	po::variables_map vm;
+	try
+	{
+		po::store(po::parse_command_line(argc,argv,desc),vm);
+		po::notify(vm);
+	}
+	catch(const po::error &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	if(vm.count("help"))
+	{
+		std::cout << desc << std::endl;
+		return 0;
+	}
+
+	sigset_t sigs;
+	sigemptyset(&sigs);
+	sigaddset(&sigs,SIGINT);
+	sigaddset(&sigs,SIGTERM);
+	pthread_sigmask(SIG_BLOCK,&sigs,nullptr);
+
+	FakeDrive drive(opts);
+	drive.populate(dirs,files,fileSize);
+	drive.start(port);
+	if(!secretFile.empty())
+		std::ofstream(secretFile) << drive.getClientSecret();
+	std::cout << drive.getRootUrl() << std::endl;
+
+	int sig;
+	sigwait(&sigs,&sig);
+	drive.stop();
+	const FakeDrive::Stats &st=drive.getStats();
+	std::cout << "requests: " << st.requests << ", throttled: " << st.throttled << ", failed: " << st.failed
+			  << ", media bytes: " << st.mediaBytes << std::endl;
+	return 0;
+}
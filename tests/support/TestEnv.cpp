@@ -0,0 +1,64 @@
+#include "TestEnv.h"
+#include "control/Application.h"
+#include "providers/memory/MemoryProvider.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+namespace testenv
+{
+
+namespace
+{
+	std::once_flag appOnce;
+	uptr<TempDir> appDir;
+	std::atomic<size_t> lastSession{0};
+}
+
+Application &app()
+{
+	std::call_once(appOnce,[]()
+	{
+		appDir.reset(new TempDir);
+		std::atexit([](){ appDir.reset(); });
+		char name[]="test";
+		char *argv[]={name,nullptr};
+		Application::create({"memory"},1,argv,appDir->path());
+	});
+	return *Application::instance();
+}
+
+void setProperty(const std::string &name,const std::string &value)
+{
+	app().getConfiguration()->setProperty(name,value);
+}
+
+IProviderSessionPtr memorySession()
+{
+	const IProviderPtr &provider=createMemoryProvider(app().getConfiguration());
+	return provider->createSession("memory"+std::to_string(++lastSession),IProvider::PropList());
+}
+
+IFileSystemPtr memoryFS()
+{
+	return memorySession()->getFileSystem();
+}
+
+TempDir::TempDir()
+{
+	char tmpl[]="/tmp/g2f_test.XXXXXX";
+	_path=mkdtemp(tmpl);
+}
+
+TempDir::~TempDir()
+{
+	boost::system::error_code ec;
+	fs::remove_all(_path,ec);
+}
+
+const fs::path &TempDir::path() const
+{
+	return _path;
+}
+
+}
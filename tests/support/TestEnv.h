@@ -0,0 +1,40 @@
+#pragma once
+
+#include "utils/decls.h"
+#include "fs/IFileSystem.h"
+#include "providers/IProviderSession.h"
+
+class Application;
+
+/**
+ * @brief Environment of tests and benchmarks
+ *
+ * Application has 'memory' account, its configuration and cache
+ * live in temporary directory removed at exit.
+ *********************************************************************/
+namespace testenv
+{
+	// Created on first call
+	Application &app();
+
+	// Global property is set for file systems created after
+	void setProperty(const std::string &name,const std::string &value);
+
+	// New session of memory provider (own cache directory)
+	IProviderSessionPtr memorySession();
+	// Memory file system of new session
+	IFileSystemPtr memoryFS();
+
+	// Temporary directory removed on destruction
+	class TempDir
+	{
+	public:
+		TempDir();
+		~TempDir();
+
+		const fs::path &path() const;
+
+	private:
+		fs::path _path;
+	};
+}
@@ -0,0 +1,141 @@
+#include "fs/AbstractFileSystem.h"
+#include "support/TestEnv.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	class AbstractFileSystemTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			_holder=testenv::memoryFS();
+			_fs=dynamic_cast<AbstractFileSystem*>(_holder.get());
+			ASSERT_TRUE(_fs);
+		}
+
+		INode *write(const std::string &path,const std::string &content)
+		{
+			INode *n=std::get<1>(_fs->createNode(path,false));
+			uptr<IContentHandle> h(n->openContent(O_WRONLY|O_TRUNC));
+			h->write(content.data(),content.size(),0);
+			h->close();
+			return n;
+		}
+
+		std::string read(const std::string &path)
+		{
+			INode *n=_fs->get(path);
+			std::string ret(n->getSize(),'\0');
+			uptr<IContentHandle> h(n->openContent(O_RDONLY));
+			ret.resize(std::max<int>(0,h->read(&ret[0],ret.size(),0)));
+			h->close();
+			return ret;
+		}
+
+		IFileSystemPtr _holder;
+		AbstractFileSystem *_fs=nullptr;
+	};
+}
+
+TEST_F(AbstractFileSystemTest, directoryIteratorIsSnapshotOfChildren)
+{
+	_fs->createNode("/dir",true);
+	for(int i=0;i<3;++i)
+		write("/dir/f"+std::to_string(i),"x");
+
+	IDirectoryIteratorPtr it=_fs->get("/dir")->getDirectoryIterator();
+	ASSERT_EQ(IFileSystem::RemoveSuccess,_fs->removeNode("/dir/f1"));
+	write("/dir/f3","x");
+
+	size_t listed=0;
+	for(;it->hasNext();it->next())
+		++listed;
+	EXPECT_EQ(3u,listed);
+}
+
+TEST_F(AbstractFileSystemTest, replacingByNodeOfSameCloudCopiesIt)
+{
+	write("/a","new");
+	const std::string replacedId=write("/b","old content")->getId();
+
+	_fs->replaceNode("/b",*_fs->get("/a"));
+	EXPECT_FALSE(_fs->findById(replacedId));
+	ASSERT_TRUE(_fs->get("/b"));
+	EXPECT_NE(_fs->get("/a")->getId(),_fs->get("/b")->getId());
+	EXPECT_EQ("new",read("/b"));
+	EXPECT_EQ("new",read("/a"));
+}
+
+TEST_F(AbstractFileSystemTest, refillOfDirectoryDropsCachedChildren)
+{
+	_fs->createNode("/dir",true);
+	const std::string id=write("/dir/f","x")->getId();
+	ASSERT_TRUE(_fs->get("/dir/f"));
+
+	ASSERT_TRUE(_fs->fillDir(_fs->get("/dir")->getId()));
+	INode *n=_fs->get("/dir/f");
+	ASSERT_TRUE(n);
+	EXPECT_EQ(_fs->findById(id),n);
+	EXPECT_EQ("x",read("/dir/f"));
+}
+
+TEST_F(AbstractFileSystemTest, removedFileIsKeptWhileOpen)
+{
+	_fs->createNode("/dir",true);
+	write("/dir/f","content");
+	uptr<IContentHandle> h(_fs->get("/dir/f")->openContent(O_RDONLY));
+	ASSERT_EQ(IFileSystem::RemoveSuccess,_fs->removeNode("/dir"));
+	EXPECT_FALSE(_fs->get("/dir/f"));
+
+	// a new node mustn't reuse memory of removed one while it's open
+	write("/g","other");
+	EXPECT_EQ("f",h->getMeta()->getName().string());
+	char buf[16];
+	EXPECT_EQ(7,h->read(buf,sizeof(buf),0));
+	h->close();
+	h.reset();
+	EXPECT_EQ("other",read("/g"));
+}
+
+TEST_F(AbstractFileSystemTest, lookupIsSafeWhileDirectoryIsRefilled)
+{
+	_fs->createNode("/dir",true);
+	for(int i=0;i<20;++i)
+		write("/dir/f"+std::to_string(i),"x");
+	const std::string dirId=_fs->get("/dir")->getId();
+
+	std::atomic<bool> stop{false};
+	std::thread refill([&]
+	{
+		while(!stop)
+			_fs->fillDir(dirId);
+	});
+	size_t found=0;
+	for(int round=0;round<200;++round)
+	{
+		for(int i=0;i<20;++i)
+			found+=_fs->get("/dir/f"+std::to_string(i))!=nullptr;
+	}
+	stop=true;
+	refill.join();
+	EXPECT_EQ(200u*20,found);
+}
+
+TEST_F(AbstractFileSystemTest, staleSizeIsRefreshedByDownload)
+{
+	INode *n=write("/f","content");
+	_fs->getContentManager().deleteFile(n->getId());
+	// metadata fetched before the file was changed in cloud
+	n->setSize(3);
+
+	uptr<IContentHandle> h(n->openContent(O_RDONLY));
+	// read waits for background download
+	char buf[16];
+	EXPECT_EQ(7,h->read(buf,sizeof(buf),0));
+	h->close();
+	EXPECT_EQ(7u,n->getSize());
+}
@@ -0,0 +1,122 @@
+#include "utils/AdaptiveLimiter.h"
+#include "utils/RetryEngine.h"
+#include "fake/FakeDrive.h"
+#include "fake/HttpConnection.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	void request(AdaptiveLimiter &limiter,AdaptiveLimiter::Outcome outcome)
+	{
+		uint64_t ticket=0;
+		ASSERT_TRUE(limiter.acquire(ticket));
+		limiter.release(ticket,outcome);
+	}
+}
+
+TEST(AdaptiveLimiterTest, failedRequestsKeepLimits)
+{
+	AdaptiveLimiter limiter(10,4,20);
+	request(limiter,AdaptiveLimiter::Failed);
+	EXPECT_DOUBLE_EQ(10,limiter.getRate());
+	EXPECT_EQ(4u,limiter.getConcurrency());
+
+	request(limiter,AdaptiveLimiter::Throttled);
+	EXPECT_DOUBLE_EQ(5,limiter.getRate());
+	EXPECT_EQ(2u,limiter.getConcurrency());
+
+	request(limiter,AdaptiveLimiter::Failed);
+	EXPECT_DOUBLE_EQ(5,limiter.getRate());
+	EXPECT_EQ(2u,limiter.getConcurrency());
+	EXPECT_EQ(0u,limiter.getActive());
+}
+
+TEST(AdaptiveLimiterTest, increaseOfMinimalRateIsBounded)
+{
+	AdaptiveLimiter limiter(100,0,20);
+	for(int i=0;i<10;++i)
+		request(limiter,AdaptiveLimiter::Throttled);
+	const double low=limiter.getRate();
+	ASSERT_LT(low,0.2);
+
+	request(limiter,AdaptiveLimiter::Success);
+	EXPECT_GT(limiter.getRate(),low);
+	EXPECT_LE(limiter.getRate(),low+1);
+}
+
+TEST(AdaptiveLimiterTest, exceptionOfRequestDoesntCountAsSuccess)
+{
+	AdaptiveLimiterPtr limiter=std::make_shared<AdaptiveLimiter>(100,0,20);
+	RetryEngine retry;
+	retry.setLimiter(RetryEngine::Metadata,limiter);
+	for(int i=0;i<3;++i)
+		request(*limiter,AdaptiveLimiter::Throttled);
+	const double low=limiter->getRate();
+
+	EXPECT_THROW(retry.execute([]() -> G2FError { throw std::runtime_error("broken"); }),std::runtime_error);
+	EXPECT_DOUBLE_EQ(low,limiter->getRate());
+	EXPECT_EQ(0u,limiter->getActive());
+}
+
+TEST(AdaptiveLimiterTest, heldSlotLimitsConcurrencyUntilReleased)
+{
+	AdaptiveLimiterPtr limiter=std::make_shared<AdaptiveLimiter>(0,1,1);
+	RetryEngine retry;
+	retry.setLimiter(RetryEngine::Media,limiter);
+	{
+		RetryEngine::Slot slot;
+		ASSERT_FALSE(retry.execute([](){ return G2FError(); },RetryEngine::Media,&slot));
+		EXPECT_EQ(1u,limiter->getActive());
+	}
+	EXPECT_EQ(0u,limiter->getActive());
+}
+
+// Clients limited by one AdaptiveLimiter settle near quota of fake server
+TEST(AdaptiveLimiterTest, convergesToQuotaOfServer)
+{
+	const double quota=20;
+	FakeDrive::Options opts;
+	opts.quotaRate=quota;
+	opts.quotaBurst=5;
+	FakeDrive drive(opts);
+	drive.start();
+	const std::string url=drive.getRootUrl()+"drive/v2/about";
+
+	AdaptiveLimiter limiter(quota*10,4,1);
+	const Clock::time_point begin=Clock::now();
+	const Clock::time_point measured=begin+std::chrono::milliseconds(1500);
+	const Clock::time_point end=begin+std::chrono::milliseconds(3500);
+	std::atomic<size_t> succeeded{0},throttled{0};
+
+	std::vector<std::thread> clients;
+	for(int i=0;i<4;++i)
+		clients.emplace_back([&]()
+		{
+			while(Clock::now()<end)
+			{
+				uint64_t ticket=0;
+				ASSERT_TRUE(limiter.acquire(ticket));
+				const bool inWindow=Clock::now()>=measured;
+				HttpConnection c("GET",url);
+				const bool quotaError=c.getStatus()==403;
+				c.readAll();
+				limiter.release(ticket,quotaError ? AdaptiveLimiter::Throttled : AdaptiveLimiter::Success);
+				if(inWindow)
+					++(quotaError ? throttled : succeeded);
+			}
+		});
+	for(std::thread &t : clients)
+		t.join();
+
+	const double seconds=std::chrono::duration<double>(end-measured).count();
+	const double rate=succeeded/seconds;
+	EXPECT_GE(rate,quota/4);
+	EXPECT_LE(rate,quota+opts.quotaBurst);
+	EXPECT_LT(double(throttled),0.25*(succeeded+throttled));
+	EXPECT_LT(limiter.getRate(),2*quota);
+}
@@ -0,0 +1,84 @@
+#include "fs/CacheWarmer.h"
+#include "support/TestEnv.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <future>
+#include <thread>
+
+namespace
+{
+	class CacheWarmerTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			_holder=testenv::memoryFS();
+			_fs=dynamic_cast<AbstractFileSystem*>(_holder.get());
+			ASSERT_TRUE(_fs);
+			_fs->createNode("/dir",true);
+			_fs->createNode("/dir/sub",true);
+			_ids.push_back(write("/dir/a","aaa"));
+			_ids.push_back(write("/dir/sub/b","bbbb"));
+			_other=write("/other","c");
+		}
+
+		// Uploads content and drops it from cache
+		std::string write(const std::string &path,const std::string &content)
+		{
+			INode *n=std::get<1>(_fs->createNode(path,false));
+			uptr<IContentHandle> h(n->openContent(O_WRONLY|O_TRUNC));
+			h->write(content.data(),content.size(),0);
+			h->close();
+			_fs->getContentManager().deleteFile(n->getId());
+			return n->getId();
+		}
+
+		void wait(CacheWarmer &warmer)
+		{
+			for(int i=0;i<500 && warmer.isRunning();++i)
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			ASSERT_FALSE(warmer.isRunning());
+		}
+
+		IFileSystemPtr _holder;
+		AbstractFileSystem *_fs=nullptr;
+		std::vector<std::string> _ids;
+		std::string _other;
+	};
+}
+
+TEST_F(CacheWarmerTest, prefetchesContentMatchedByGlob)
+{
+	CacheWarmer warmer(*_fs,std::make_shared<WorkerPool>(2));
+	warmer.setGlobs({"/dir"});
+	ASSERT_TRUE(warmer.start());
+	wait(warmer);
+
+	ContentManager &cm=_fs->getContentManager();
+	for(const std::string &id : _ids)
+		EXPECT_TRUE(cm.is(id)) << id;
+	EXPECT_FALSE(cm.is(_other));
+	EXPECT_NE(std::string::npos,warmer.getProgress().find("2/2"));
+}
+
+TEST_F(CacheWarmerTest, skipsNodesRemovedBeforeTaskRuns)
+{
+	// Single thread runs: first gate, walk of /dir, second gate, then tasks posted by the walk
+	WorkerPoolPtr pool=std::make_shared<WorkerPool>(1);
+	std::promise<void> first,second,walked;
+	pool->post([&]{ first.get_future().wait(); });
+	CacheWarmer warmer(*_fs,pool);
+	warmer.setGlobs({"/dir"});
+	ASSERT_TRUE(warmer.start());
+	pool->post([&]{ walked.set_value(); second.get_future().wait(); });
+
+	first.set_value();
+	walked.get_future().wait();
+	ASSERT_EQ(IFileSystem::RemoveSuccess,_fs->removeNode("/dir/sub/b"));
+	ASSERT_EQ(IFileSystem::RemoveSuccess,_fs->removeNode("/dir/sub"));
+	second.set_value();
+	wait(warmer);
+
+	EXPECT_TRUE(_fs->getContentManager().is(_ids[0]));
+	EXPECT_NE(std::string::npos,warmer.getProgress().find("errors 0"));
+}
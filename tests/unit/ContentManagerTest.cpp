@@ -0,0 +1,230 @@
+#include "fs/ContentManager.h"
+#include "support/TestEnv.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace
+{
+	class StringReader : public ContentManager::IReader
+	{
+	public:
+		StringReader(const std::string &data)
+			: _data(data)
+		{}
+
+		virtual bool done() override
+		{
+			return _pos==_data.size();
+		}
+		virtual int64_t read(char *buffer, int64_t bufSize) override
+		{
+			const size_t n=std::min<size_t>(bufSize,_data.size()-_pos);
+			_data.copy(buffer,n,_pos);
+			_pos+=n;
+			return n;
+		}
+		virtual G2FError error() override
+		{
+			return G2FError();
+		}
+
+	private:
+		std::string _data;
+		size_t _pos=0;
+	};
+
+	// Stream that is broken after 'size' bytes without an error
+	class TruncatedReader : public StringReader
+	{
+	public:
+		TruncatedReader(const std::string &data,size_t size)
+			: StringReader(data),
+			  _left(size)
+		{}
+
+		virtual int64_t read(char *buffer, int64_t bufSize) override
+		{
+			const int64_t ret=StringReader::read(buffer,std::min<int64_t>(bufSize,_left));
+			_left-=ret;
+			return ret;
+		}
+
+	private:
+		size_t _left;
+	};
+
+	class ContentManagerTest : public ::testing::Test
+	{
+	protected:
+		void create(const std::string &id,const std::string &data)
+		{
+			StringReader r(data);
+			_cm.createFile(id,&r,data.size());
+		}
+
+		size_t blobs()
+		{
+			size_t ret=0;
+			boost::system::error_code ec;
+			for(fs::recursive_directory_iterator it(_dir.path()/".objects",ec),itEnd;!ec && it!=itEnd;it.increment(ec))
+				ret+=fs::is_regular_file(it->status());
+			return ret;
+		}
+
+		testenv::TempDir _dir;
+		ContentManager _cm{_dir.path()};
+		const MD5Signature _md5{{1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16}};
+	};
+}
+
+TEST_F(ContentManagerTest, sharesContentWithSameMD5)
+{
+	create("a","content");
+	ContentManager::Version v;
+	v.md5=_md5;
+	_cm.setVersion("a",v);
+	_cm.storeContent("a",_md5);
+	ASSERT_EQ(1u,blobs());
+
+	ASSERT_TRUE(_cm.shareContent("b",_md5));
+	EXPECT_EQ(7u,_cm.getCachedSize("b"));
+}
+
+TEST_F(ContentManagerTest, detachReleasesBlobReferencedByNobody)
+{
+	create("a","content");
+	ContentManager::Version v;
+	v.md5=_md5;
+	_cm.setVersion("a",v);
+	_cm.storeContent("a",_md5);
+	ASSERT_EQ(1u,blobs());
+
+	// writing detaches the only file sharing the blob
+	_cm.closeFile(_cm.openFile("a",O_RDWR));
+	EXPECT_EQ(0u,blobs());
+	EXPECT_TRUE(_cm.is("a"));
+}
+
+TEST_F(ContentManagerTest, detachKeepsBlobSharedByOthers)
+{
+	create("a","content");
+	ContentManager::Version v;
+	v.md5=_md5;
+	_cm.setVersion("a",v);
+	_cm.storeContent("a",_md5);
+	ASSERT_TRUE(_cm.shareContent("b",_md5));
+
+	_cm.truncateFile("a",7,3);
+	EXPECT_EQ(1u,blobs());
+	EXPECT_EQ(7u,_cm.getCachedSize("b"));
+}
+
+TEST_F(ContentManagerTest, changedContentIsDirtyUntilVersionIsSet)
+{
+	create("a","content");
+	EXPECT_FALSE(_cm.isDirty("a"));
+
+	_cm.truncateFile("a",7,3);
+	EXPECT_TRUE(_cm.isDirty("a"));
+
+	_cm.setVersion("a",ContentManager::Version());
+	EXPECT_FALSE(_cm.isDirty("a"));
+}
+
+TEST_F(ContentManagerTest, openingForWritingDoesntMakeDirty)
+{
+	create("a","content");
+	const int64_t fd=_cm.openFile("a",O_RDWR);
+	EXPECT_FALSE(_cm.isDirty("a"));
+	_cm.writeContent(fd,"x",1,0);
+	EXPECT_TRUE(_cm.isDirty("a"));
+	_cm.closeFile(fd);
+}
+
+TEST_F(ContentManagerTest, downloadedFileIsntEvicted)
+{
+	_cm.beginDownload("a");
+	_cm.createFile("a",nullptr);
+	create("b","content");
+
+	ContentManager::Limits limits;
+	limits.maxFiles=1;
+	_cm.setLimits(limits);
+	EXPECT_TRUE(_cm.is("a"));
+	EXPECT_FALSE(_cm.is("b"));
+
+	_cm.endDownload("a");
+	EXPECT_EQ(1u,_cm.getCachedFiles());
+}
+
+TEST_F(ContentManagerTest, scanDropsInterruptedDownloadAndKeepsUnsyncedContent)
+{
+	create("a","content");
+	_cm.setVersion("a",ContentManager::Version());
+	// changed after sync (mtime of file systems could be coarser than time between writes)
+	const timespec later[2]={{0,UTIME_OMIT},{time(nullptr)+10,0}};
+	ASSERT_EQ(0,utimensat(AT_FDCWD,(_dir.path()/"a").c_str(),later,0));
+	_cm.beginDownload("b");
+	create("b","partial");
+	create("c","synced");
+	_cm.setVersion("c",ContentManager::Version());
+
+	ContentManager restarted(_dir.path());
+	EXPECT_TRUE(restarted.isDirty("a"));
+	EXPECT_FALSE(restarted.is("b"));
+	EXPECT_FALSE(restarted.isDirty("c"));
+}
+
+// Cache written before versions were recorded has no sidecars
+TEST_F(ContentManagerTest, scannedContentWithoutVersionIsStale)
+{
+	create("a","content");
+	create("b","content");
+
+	ContentManager restarted(_dir.path());
+	EXPECT_TRUE(restarted.is("a"));
+	EXPECT_FALSE(restarted.isDirty("a"));
+	ContentManager::Version remote;
+	remote.md5=_md5;
+	EXPECT_FALSE(restarted.isActual("a",remote));
+
+	// nothing holds it from eviction
+	ContentManager::Limits limits;
+	limits.maxFiles=1;
+	restarted.setLimits(limits);
+	EXPECT_EQ(0u,restarted.getCachedFiles());
+}
+
+TEST_F(ContentManagerTest, contentEndedEarlyIsntStored)
+{
+	TruncatedReader r("content",3);
+	EXPECT_THROW(_cm.createFile("a",&r,7),G2FException);
+	EXPECT_EQ(0u,_cm.getCachedSize("a"));
+}
+
+TEST_F(ContentManagerTest, completeContentOfUnexpectedSizeIsStored)
+{
+	// expected size comes from stale metadata, caller checks reported length
+	StringReader r("content");
+	EXPECT_EQ(7u,_cm.createFile("a",&r,8));
+	EXPECT_EQ(7u,_cm.getCachedSize("a"));
+
+	// size of exported content isn't known in advance
+	StringReader exported("content");
+	_cm.createFile("b",&exported);
+	EXPECT_EQ(7u,_cm.getCachedSize("b"));
+}
+
+TEST_F(ContentManagerTest, contentOpenForWritingIsntShared)
+{
+	create("a","content");
+	const int64_t fd=_cm.openFile("a",O_RDWR);
+	_cm.storeContent("a",_md5);
+	EXPECT_EQ(0u,blobs());
+	_cm.writeContent(fd,"C",1,0);
+	_cm.closeFile(fd);
+
+	_cm.storeContent("a",_md5);
+	EXPECT_EQ(1u,blobs());
+}
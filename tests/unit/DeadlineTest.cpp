@@ -0,0 +1,107 @@
+#include "utils/Deadline.h"
+#include "utils/WorkerPool.h"
+#include "utils/TokenBucket.h"
+#include "utils/AdaptiveLimiter.h"
+#include "utils/RetryEngine.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::duration elapsed(const std::function<void()> &f)
+	{
+		const Clock::time_point begin=Clock::now();
+		f();
+		return Clock::now()-begin;
+	}
+}
+
+TEST(DeadlineTest, poolTaskInheritsDeadlineOfPoster)
+{
+	WorkerPool pool(1);
+	bool unlimited=true;
+	size_t remaining=0;
+	{
+		Deadline::Scope ds(1000);
+		pool.post([&]()
+		{
+			unlimited=Deadline::isUnlimited();
+			remaining=Deadline::remaining();
+		});
+		pool.wait();
+	}
+	EXPECT_FALSE(unlimited);
+	EXPECT_LE(remaining,1000u);
+
+	pool.post([&](){ unlimited=Deadline::isUnlimited(); });
+	pool.wait();
+	EXPECT_TRUE(unlimited);
+}
+
+TEST(DeadlineTest, backgroundTaskHasOwnBudget)
+{
+	WorkerPool pool(1);
+	pool.setTaskBudget(5000);
+	size_t remaining=0;
+	{
+		Deadline::Scope ds(100);
+		pool.post([&]()
+		{
+			// deadline of the poster is over by now
+			std::this_thread::sleep_for(std::chrono::milliseconds(150));
+			remaining=Deadline::remaining();
+		});
+		pool.wait();
+	}
+	EXPECT_GT(remaining,4000u);
+	EXPECT_LE(remaining,5000u);
+
+	bool unlimited=false;
+	pool.setTaskBudget(0);
+	pool.post([&](){ unlimited=Deadline::isUnlimited(); });
+	pool.wait();
+	EXPECT_TRUE(unlimited);
+}
+
+TEST(DeadlineTest, tokenBucketDoesntWaitPastDeadline)
+{
+	TokenBucket bucket(1,1);
+	ASSERT_TRUE(bucket.acquire());
+
+	Deadline::Scope ds(100);
+	bool acquired=true;
+	EXPECT_LT(elapsed([&](){ acquired=bucket.acquire(); }),std::chrono::milliseconds(100));
+	EXPECT_FALSE(acquired);
+}
+
+TEST(DeadlineTest, limiterDoesntWaitForConcurrencyPastDeadline)
+{
+	AdaptiveLimiter limiter(0,1,1);
+	uint64_t first=0,second=0;
+	ASSERT_TRUE(limiter.acquire(first));
+
+	{
+		Deadline::Scope ds(50);
+		EXPECT_FALSE(limiter.acquire(second));
+	}
+	limiter.release(first,AdaptiveLimiter::Success);
+	EXPECT_EQ(0u,limiter.getActive());
+}
+
+TEST(DeadlineTest, retryStopsAtDeadline)
+{
+	RetryEngine engine;
+	engine.setPolicy(RetryEngine::Transient,{10,200,0});
+	size_t attempts=0;
+	G2FError e;
+	Deadline::Scope ds(300);
+	EXPECT_LT(elapsed([&]()
+	{
+		e=engine.execute([&](){ ++attempts; return G2FError(HttpServerError); });
+	}),std::chrono::milliseconds(300));
+	EXPECT_EQ(HttpServerError,e.value());
+	EXPECT_GE(attempts,1u);
+	EXPECT_LE(attempts,2u);
+}
@@ -0,0 +1,126 @@
+#include "fake/FakeDrive.h"
+#include "fake/HttpConnection.h"
+#include <gtest/gtest.h>
+#include <json/json.h>
+#include <sstream>
+
+namespace
+{
+	Json::Value parse(const std::string &body)
+	{
+		Json::Value ret;
+		Json::CharReaderBuilder b;
+		std::string errs;
+		std::istringstream in(body);
+		Json::parseFromStream(b,in,&ret,&errs);
+		return ret;
+	}
+
+	class FakeDriveTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			_dirId=_drive.addFolder("root","dir");
+			_fileId=_drive.addFile(_dirId,"file","content");
+			_drive.start();
+		}
+
+		std::string url(const std::string &path)
+		{
+			return _drive.getRootUrl()+path;
+		}
+
+		FakeDrive _drive;
+		std::string _dirId;
+		std::string _fileId;
+	};
+}
+
+TEST_F(FakeDriveTest, servesMetadataAndMedia)
+{
+	HttpConnection meta("GET",url("drive/v2/files/"+_fileId));
+	ASSERT_EQ(200,meta.getStatus());
+	const Json::Value &file=parse(meta.readAll());
+	EXPECT_EQ("file",file["title"].asString());
+	EXPECT_EQ("7",file["fileSize"].asString());
+	EXPECT_EQ("9a0364b9e99bb480dd25e1f0284c8555",file["md5Checksum"].asString());
+	EXPECT_EQ(_dirId,file["parents"][0]["id"].asString());
+
+	HttpConnection media("GET",url("drive/v2/files/"+_fileId+"?alt=media"));
+	ASSERT_EQ(200,media.getStatus());
+	EXPECT_EQ("content",media.readAll());
+}
+
+TEST_F(FakeDriveTest, listsChildrenAndFilesByQuery)
+{
+	HttpConnection children("GET",url("drive/v2/files/"+_dirId+"/children"));
+	const Json::Value items=parse(children.readAll())["items"];
+	ASSERT_EQ(1u,items.size());
+	EXPECT_EQ(_fileId,items[0]["id"].asString());
+
+	HttpConnection list("GET",url("drive/v2/files?q=%27root%27%20in%20parents%20and%20trashed%3Dfalse"));
+	const Json::Value files=parse(list.readAll())["items"];
+	ASSERT_EQ(1u,files.size());
+	EXPECT_EQ(_dirId,files[0]["id"].asString());
+}
+
+TEST_F(FakeDriveTest, insertsUpdatesAndReportsChanges)
+{
+	HttpConnection about("GET",url("drive/v2/about"));
+	const std::string &start=std::to_string(std::stoll(parse(about.readAll())["largestChangeId"].asString())+1);
+
+	HttpConnection insert("POST",url("drive/v2/files"),R"({"title":"new","parents":[{"id":"root"}]})");
+	const std::string &id=parse(insert.readAll())["id"].asString();
+	ASSERT_FALSE(id.empty());
+
+	HttpConnection upload("PUT",url("upload/drive/v2/files/"+id+"?uploadType=media"),"data","text/plain");
+	ASSERT_EQ(200,upload.getStatus());
+	std::string content;
+	ASSERT_TRUE(_drive.getContent(id,content));
+	EXPECT_EQ("data",content);
+
+	HttpConnection del("DELETE",url("drive/v2/files/"+_fileId));
+	EXPECT_EQ(204,del.getStatus());
+
+	HttpConnection changes("GET",url("drive/v2/changes?startChangeId="+start));
+	const Json::Value items=parse(changes.readAll())["items"];
+	ASSERT_EQ(2u,items.size());
+	EXPECT_EQ(id,items[0]["fileId"].asString());
+	EXPECT_EQ(_fileId,items[1]["fileId"].asString());
+	EXPECT_TRUE(items[1]["deleted"].asBool());
+}
+
+TEST_F(FakeDriveTest, injectsQuotaErrors)
+{
+	FakeDrive::Options opts;
+	opts.quotaRate=1;
+	opts.quotaBurst=2;
+	_drive.setOptions(opts);
+
+	int throttled=0;
+	for(int i=0;i<5;++i)
+	{
+		HttpConnection c("GET",url("drive/v2/about"));
+		if(c.getStatus()==403)
+		{
+			EXPECT_NE(std::string::npos,c.readAll().find("userRateLimitExceeded"));
+			++throttled;
+		}
+	}
+	EXPECT_GE(throttled,2);
+	EXPECT_EQ(size_t(throttled),_drive.getStats().throttled);
+}
+
+TEST_F(FakeDriveTest, limitsBandwidthOfMedia)
+{
+	const std::string &big=_drive.addFile("root","big",std::string(256*1024,'x'));
+	FakeDrive::Options opts;
+	opts.bandwidth=1024*1024;
+	_drive.setOptions(opts);
+
+	const auto begin=std::chrono::steady_clock::now();
+	HttpConnection media("GET",url("drive/v2/files/"+big+"?alt=media"));
+	EXPECT_EQ(256*1024u,media.readAll().size());
+	EXPECT_GE(std::chrono::steady_clock::now()-begin,std::chrono::milliseconds(200));
+}
@@ -0,0 +1,86 @@
+#include "presentation/FuseGate.h"
+#include "fs/IContentHandle.h"
+#include "support/TestEnv.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+
+namespace
+{
+	class FuseGateTest : public ::testing::Test
+	{
+	protected:
+		void TearDown() override
+		{
+			testenv::setProperty("op_deadline","60");
+			testenv::setProperty("io_policy","");
+		}
+
+		static void write(IFileSystem &fs,const std::string &path,const std::string &content)
+		{
+			INode *n=fs.get(path);
+			if(!n)
+				n=std::get<1>(fs.createNode(path,false));
+			uptr<IContentHandle> h(n->openContent(O_WRONLY|O_TRUNC));
+			h->write(content.data(),content.size(),0);
+			h->close();
+		}
+
+		static IOPolicy::Options open(FuseGate &gate,const char *path,int flags=O_RDONLY)
+		{
+			IContentHandle *chn=nullptr;
+			EXPECT_EQ(0,gate.openContent(path,flags,chn));
+			uptr<IContentHandle> h(chn);
+			const IOPolicy::Options &ret=gate.getIOOptions(path,flags,*h);
+			h->close();
+			return ret;
+		}
+	};
+}
+
+TEST_F(FuseGateTest, prepareReadsGlobalPropertiesAndMountsSessions)
+{
+	testenv::setProperty("op_deadline","5");
+	FuseGate gate({{"a",testenv::memorySession()},{"b",testenv::memorySession()}});
+	gate.prepare();
+	EXPECT_EQ(5000u,gate.getOpDeadline());
+
+	// several accounts are mounted each at directory named by account
+	IFileSystem &fs=gate.getFS();
+	ASSERT_TRUE(fs.get("/a"));
+	ASSERT_TRUE(fs.get("/b"));
+	write(fs,"/a/f","x");
+	EXPECT_TRUE(fs.get("/a/f"));
+	EXPECT_FALSE(fs.get("/b/f"));
+}
+
+TEST_F(FuseGateTest, pageCacheIsKeptForUnchangedFile)
+{
+	FuseGate gate({{"memory",testenv::memorySession()}});
+	gate.prepare();
+	write(gate.getFS(),"/f","content");
+
+	EXPECT_FALSE(open(gate,"/f").keepCache);
+	EXPECT_TRUE(open(gate,"/f").keepCache);
+	EXPECT_FALSE(open(gate,"/f",O_RDWR|O_TRUNC).keepCache);
+
+	write(gate.getFS(),"/f","changed content");
+	EXPECT_FALSE(open(gate,"/f").keepCache);
+	EXPECT_TRUE(open(gate,"/f").keepCache);
+
+	// version of removed file is forgotten
+	ASSERT_EQ(0,gate.removeINode("/f"));
+	write(gate.getFS(),"/f","changed content");
+	EXPECT_FALSE(open(gate,"/f").keepCache);
+}
+
+TEST_F(FuseGateTest, ioPolicyChoosesDirectIO)
+{
+	testenv::setProperty("io_policy","size>=1K:direct_io");
+	FuseGate gate({{"memory",testenv::memorySession()}});
+	gate.prepare();
+	write(gate.getFS(),"/small","x");
+	write(gate.getFS(),"/large",std::string(2048,'x'));
+
+	EXPECT_FALSE(open(gate,"/small").directIO);
+	EXPECT_TRUE(open(gate,"/large").directIO);
+}